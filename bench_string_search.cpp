@@ -0,0 +1,50 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "string_search.h"
+
+/* Compares the search kernels of the string library with the scalar loops
+ * they replace, on a haystack where the needle only appears at the end.
+ */
+
+namespace {
+
+template<typename F>
+void run(std::string const& name, F&& search) {
+    constexpr int iterations = 2000;
+
+    std::size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        found += search();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << "[BENCH] " << name << ": " << ms << " ms (" << found / iterations << ")" << std::endl;
+}
+
+}
+
+int main() {
+    std::string haystack;
+    for (int i = 0; i < 64 * 1024; ++i) {
+        haystack += "the quick brown fox jumps over the lazy dog ";
+    }
+    haystack += "needle in the haystack#";
+
+    std::string_view text(haystack);
+    std::string_view needle("needle in");
+
+    run("find, scalar", [&]() { return StringSearch::find_scalar(text, needle); });
+    run("find, vectorized", [&]() { return StringSearch::find(text, needle); });
+    run("find, std::string_view", [&]() { return text.find(needle); });
+    run("find_byte, scalar", [&]() { return StringSearch::find_byte_scalar(text, '#'); });
+    run("find_byte, vectorized", [&]() { return StringSearch::find_byte(text, '#'); });
+    run("find_byte, std::string_view", [&]() { return text.find('#'); });
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+-- Short lived tables and closures, created and released at every
+-- iteration.
+function make_point(x, y)
+    return {x = x, y = y}
+end
+
+function adder(n)
+    return function(v)
+        return v + n
+    end
+end
+
+sum = 0
+for i = 1, 20000 do
+    local p = make_point(i, i + 1)
+    local add = adder(p.y)
+    sum = sum + add(p.x) - 2 * i
+end
+
+ensure_value_type(sum, 20000, "int")
+allocations()
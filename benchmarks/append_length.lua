@@ -0,0 +1,23 @@
+-- Append and pop loops that query the length of the table on every
+-- iteration.
+t = {}
+for i = 1, 200000 do
+    t[#t + 1] = i
+end
+ensure_value_type(#t, 200000, "int")
+
+-- Stack usage: the popped keys stay in the array part as nil.
+for i = 1, 100000 do
+    t[#t] = nil
+end
+ensure_value_type(#t, 100000, "int")
+
+for round = 1, 50 do
+    for i = 1, 1000 do
+        t[#t + 1] = i
+    end
+    for i = 1, 1000 do
+        t[#t] = nil
+    end
+end
+ensure_value_type(#t, 100000, "int")
@@ -0,0 +1,17 @@
+-- Calls with a few arguments and a single result, the common case for
+-- argument and result lists.
+function add3(a, b, c)
+    return a + b + c
+end
+
+function swap(a, b)
+    return b, a
+end
+
+local total = 0
+for i = 1, 200000 do
+    total = add3(total, 1, 1)
+    local x, y = swap(i, total)
+end
+
+ensure_value_type(total, 400000, "int")
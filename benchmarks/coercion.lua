@@ -0,0 +1,7 @@
+-- Arithmetic on numeric strings, as read from input files.
+total = 0
+for i = 1, 100000 do
+    total = total + "12.5" + " 7 " - "0x10"
+end
+
+ensure_value_type(total, 350000.0, "double")
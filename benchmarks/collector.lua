@@ -0,0 +1,18 @@
+-- Garbage tables created by the main chunk, some of them in cycles that
+-- reference counting alone cannot free.
+live = {}
+sum = 0
+for i = 1, 200000 do
+    local node = {value = i}
+    node.self = node
+    local pair = {node, {i}}
+    sum = sum + pair[2][1] - node.value
+    if i % 100 == 0 then
+        live[#live + 1] = node
+    end
+end
+
+ensure_value_type(sum, 0, "int")
+ensure_value_type(#live, 2000, "int")
+ensure_value_type(live[2000].self.value, 200000, "int")
+allocations()
@@ -0,0 +1,9 @@
+-- Call path: two non-tail recursive calls per invocation.
+function fib(n)
+    if n < 2 then
+        return n
+    end
+    return fib(n - 1) + fib(n - 2)
+end
+
+print(fib(30))
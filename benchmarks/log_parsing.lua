@@ -0,0 +1,20 @@
+-- Parse log lines with the same few patterns in a loop, which compiles each
+-- of them once.
+line = "2024-05-17 12:30:45 [ERROR] worker-17 request /api/v1/items took 1234ms"
+errors = 0
+slow = 0
+for i = 1, 20000 do
+    local date, level = line:match("^(%d+%-%d+%-%d+) %S+ %[(%u+)%]")
+    if level == "ERROR" then
+        errors = errors + 1
+    end
+
+    local ms = line:match("took (%d+)ms")
+    if line:find("/api/", 1, true) and line:find("worker%-%d+") then
+        slow = slow + 1
+    end
+    line:gsub("%d", "#")
+end
+
+ensure_value_type(errors, 20000, "int")
+ensure_value_type(slow, 20000, "int")
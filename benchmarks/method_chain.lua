@@ -0,0 +1,20 @@
+-- Call path: deep chains of method calls, each returning its receiver.
+counter = { value = 0 }
+
+counter.step = function(self)
+    self.value = self.value + 1
+    return self
+end
+
+counter.chain = function(self, depth)
+    if depth == 0 then
+        return self
+    end
+    return self:step():step():step():chain(depth - 1)
+end
+
+for i = 1, 1000 do
+    counter:chain(50)
+end
+
+print(counter.value)
@@ -0,0 +1,31 @@
+-- Memory and lookups of record-like tables with string keys: 20000 records
+-- of 4 fields, then 2000 records of 40 fields.
+small = {}
+for i = 1, 20000 do
+    small[i] = {x = i, y = i + 1, z = i + 2, name = "p"}
+end
+
+big = {}
+for i = 1, 2000 do
+    r = {}
+    for j = 1, 40 do
+        r["f" .. j] = j
+    end
+    big[i] = r
+end
+
+sum = 0
+for k = 1, 2 do
+    for i = 1, 20000 do
+        p = small[i]
+        sum = sum + p.x + p.y + p.z
+    end
+end
+ensure_value_type(sum, 2 * (3 * 200010000 + 3 * 20000), "int")
+
+total = 0
+for i = 1, 2000 do
+    r = big[i]
+    total = total + r.f1 + r.f20 + r.f40
+end
+ensure_value_type(total, 2000 * 61, "int")
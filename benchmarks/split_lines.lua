@@ -0,0 +1,23 @@
+-- Split a large input into lines, and lines into fields, and keep them all.
+-- Lines and fields are slices of the input instead of copies of it.
+nl = string.char(10)
+padding = string.rep("worker-17 GET /api/v1/items/42 200 1234 ", 10)
+input = ""
+for i = 10000, 29999 do
+    input = input .. i .. padding .. nl
+end
+lines = {}
+heads = {}
+tails = {}
+count = 0
+bytes = 0
+for line in input:gmatch("[^" .. nl .. "]+") do
+    count = count + 1
+    lines[count] = line
+    heads[count] = line:sub(1, 200)
+    tails[count] = line:sub(201)
+    bytes = bytes + #tails[count]
+end
+
+ensure_value_type(count, 20000, "int")
+ensure_value_type(bytes, 4100000, "int")
@@ -0,0 +1,7 @@
+-- Report generation: a large string built by repeated appends.
+s = ""
+for i = 1, 20000 do
+    s = s .. "line " .. i .. ": some report content\n"
+end
+
+ensure_value_type(#s > 500000, true, "bool")
@@ -0,0 +1,20 @@
+-- Constructors of arrays and of records, and tables created with room for
+-- the keys they will hold.
+rows = {}
+for i = 1, 20000 do
+    rows[i] = {i, i + 1, i + 2, i + 3, i + 4, i + 5, i + 6, i + 7, i + 8, i + 9, i + 10, i + 11}
+end
+
+points = {}
+for i = 1, 20000 do
+    points[i] = {x = i, y = i, z = i, w = i, r = 1, g = 2, b = 3, a = 4, u = 0, v = 0, id = i, tag = "p"}
+end
+
+squares = table.create(50000)
+for i = 1, 50000 do
+    squares[i] = i * i
+end
+
+ensure_value_type(rows[20000][12], 20011, "int")
+ensure_value_type(points[20000].id, 20000, "int")
+ensure_value_type(#squares, 50000, "int")
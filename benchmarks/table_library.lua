@@ -0,0 +1,15 @@
+-- Queue and stack operations on an array, then a join of its values.
+queue = {}
+for i = 1, 20000 do
+    table.insert(queue, i)
+end
+for i = 1, 10000 do
+    table.insert(queue, 1, table.remove(queue))
+end
+for i = 1, 10000 do
+    table.remove(queue, 1)
+end
+
+ensure_value_type(#queue, 10000, "int")
+ensure_value_type(queue[1], 1, "int")
+ensure_value_type(#table.concat(queue, ","), 48893, "int")
@@ -0,0 +1,29 @@
+-- Sorts of numbers and strings with the default order, then of records
+-- with a comparison function.
+seed = 42
+function random(n)
+    seed = (seed * 16807) % 2147483647
+    return seed % n
+end
+
+numbers = {}
+for i = 1, 30000 do
+    numbers[i] = random(1000000)
+end
+table.sort(numbers)
+
+words = {}
+for i = 1, 20000 do
+    words[i] = "w" .. random(1000000)
+end
+table.sort(words)
+
+records = {}
+for i = 1, 10000 do
+    records[i] = {key = random(1000000)}
+end
+table.sort(records, function(a, b) return a.key < b.key end)
+
+ensure_value_type(numbers[1] <= numbers[30000], true, "bool")
+ensure_value_type(words[1] <= words[20000], true, "bool")
+ensure_value_type(records[1].key <= records[10000].key, true, "bool")
@@ -0,0 +1,221 @@
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "builtins.h"
+#include "collector.h"
+#include "conversions.h"
+#include "exceptions.h"
+#include "interpreter.h"
+#include "types.h"
+
+namespace Builtins {
+
+void register_builtins(Interpreter& interpreter) {
+    interpreter.register_global_c_function("select", new Types::Function(&select, &select_elipsis));
+    interpreter.register_global_c_function("pcall", new Types::Function(&pcall));
+    interpreter.register_global_c_function("collectgarbage", new Types::Function(&collectgarbage));
+    interpreter.register_global_c_function("setmetatable", new Types::Function(&setmetatable));
+    interpreter.register_global_c_function("getmetatable", new Types::Function(&getmetatable));
+    register_string_library(interpreter);
+    register_table_library(interpreter);
+}
+
+Types::String check_string(std::span<Types::Value const> arguments, size_t index, char const* function) {
+    if (index > arguments.size()) {
+        throw Exceptions::BadArgument(index, function, "string expected, got no value");
+    }
+
+    Types::Value const& value = arguments[index - 1];
+    if (value.is<Types::String>()) {
+        return value.as<Types::String>();
+    } else if (value.is<int>() || value.is<double>()) {
+        return Types::String(value.as_string());
+    }
+
+    throw Exceptions::BadArgument(index, function, "string expected, got " + value.type_as_string());
+}
+
+int check_int(std::span<Types::Value const> arguments, size_t index, char const* function) {
+    if (index > arguments.size()) {
+        throw Exceptions::BadArgument(index, function, "number expected, got no value");
+    }
+
+    Types::Value const& value = arguments[index - 1];
+    if (value.is<int>()) {
+        return value.as<int>();
+    }
+
+    std::optional<double> number;
+    if (value.is<double>()) {
+        number = value.as<double>();
+    } else if (value.is<Types::String>()) {
+        if (std::optional<int> i = Conversions::to_int(value.as<Types::String>().view())) {
+            return *i;
+        }
+        number = Conversions::to_double(value.as<Types::String>().view());
+    }
+
+    if (!number) {
+        throw Exceptions::BadArgument(index, function, "number expected, got " + value.type_as_string());
+    }
+
+    double intpart;
+    if (std::modf(*number, &intpart) != 0.0 || *number < std::numeric_limits<int>::min() || *number > std::numeric_limits<int>::max()) {
+        throw Exceptions::BadArgument(index, function, "number has no integer representation");
+    }
+
+    return *number;
+}
+
+int opt_int(std::span<Types::Value const> arguments, size_t index, char const* function, int value) {
+    if (index > arguments.size() || arguments[index - 1].is<Types::Nil>()) {
+        return value;
+    }
+
+    return check_int(arguments, index, function);
+}
+
+Types::Table* check_table(std::span<Types::Value const> arguments, size_t index, char const* function) {
+    if (index > arguments.size()) {
+        throw Exceptions::BadArgument(index, function, "table expected, got no value");
+    } else if (!arguments[index - 1].is<Types::Table*>()) {
+        throw Exceptions::BadArgument(index, function, "table expected, got " + arguments[index - 1].type_as_string());
+    }
+
+    return arguments[index - 1].as<Types::Table*>();
+}
+
+Types::VarList select(Interpreter& interpreter, std::span<Types::Value const> arguments) {
+    return select_elipsis(interpreter, arguments, Types::Elipsis());
+}
+
+Types::VarList select_elipsis(Interpreter& interpreter, std::span<Types::Value const> arguments, Types::Elipsis const& rest) {
+    if (arguments.empty() && rest.size() != 0) {
+        // select(...): the selector is the first value of rest.
+        Types::Value selector = rest.values().front();
+        return select_elipsis(interpreter, std::span<Types::Value const>(&selector, 1), Types::Elipsis(rest, 1));
+    } else if (arguments.empty()) {
+        throw Exceptions::BadArgument(1, "select", "number expected, got no value");
+    }
+
+    std::span<Types::Value const> values = arguments.subspan(1);
+    size_t count = values.size() + rest.size();
+    Types::Value const& selector = arguments.front();
+    if (selector.is<Types::String>() && selector.as<Types::String>().view() == "#") {
+        return { Types::Var::make(Types::Value::make_int(count)) };
+    }
+
+    int n = selector.as_int_weak();
+    if (n < 0) {
+        n += count;
+        if (n < 0) {
+            throw Exceptions::BadArgument(1, "select", "index out of range");
+        }
+    } else if (n == 0) {
+        throw Exceptions::BadArgument(1, "select", "index out of range");
+    } else {
+        --n;
+    }
+
+    Types::VarList results;
+    if (static_cast<size_t>(n) >= values.size() && rest.size() != 0) {
+        // Only values of rest are selected, if any: share them, as ... does.
+        Types::Value tail;
+        tail.value() = Types::Elipsis(rest, n - values.size());
+        results.push_back(Types::Var::make(std::move(tail)));
+    } else if (static_cast<size_t>(n) < values.size()) {
+        std::span<Types::Value const> extra = rest.values();
+        results.reserve(count - n);
+        for (Types::Value const& value: values.subspan(n)) {
+            results.push_back(Types::Var::make(Types::Value(value)));
+        }
+        for (Types::Value const& value: extra) {
+            results.push_back(Types::Var::make(Types::Value(value)));
+        }
+    }
+
+    return results;
+}
+
+Types::VarList pcall(Interpreter& interpreter, std::span<Types::Value const> arguments) {
+    if (arguments.empty()) {
+        throw Exceptions::BadArgument(1, "pcall", "value expected");
+    }
+
+    Types::VarList values;
+    try {
+        if (!arguments.front().is<Types::Function*>()) {
+            throw Exceptions::BadCall(arguments.front().type_as_string());
+        }
+
+        values = interpreter.call(arguments.front().as<Types::Function*>(), arguments.subspan(1));
+    } catch (Exceptions::string_exception& e) {
+        std::string message(e.what());
+        if (!message.empty() && message.back() == '\n') {
+            message.pop_back();
+        }
+
+        return { Types::Var::make(Types::Value::make_false()), Types::Var::make(Types::Value::make_string(Types::String(std::move(message)))) };
+    }
+
+    Types::VarList results;
+    results.reserve(values.size() + 1);
+    results.push_back(Types::Var::make(Types::Value::make_true()));
+    for (Types::Var& value: values) {
+        results.push_back(std::move(value));
+    }
+
+    return results;
+}
+
+Types::VarList setmetatable(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::Table* table = check_table(arguments, 1, "setmetatable");
+    if (arguments.size() < 2 || !(arguments[1].is<Types::Nil>() || arguments[1].is<Types::Table*>())) {
+        throw Exceptions::BadArgument(2, "setmetatable", "nil or table expected");
+    }
+
+    table->set_metatable(arguments[1]);
+    return { Types::Var::make(Types::Value(arguments[0])) };
+}
+
+Types::VarList getmetatable(Interpreter&, std::span<Types::Value const> arguments) {
+    if (arguments.empty()) {
+        throw Exceptions::BadArgument(1, "getmetatable", "value expected");
+    }
+
+    if (arguments[0].is<Types::Table*>()) {
+        return { Types::Var::make(Types::Value(arguments[0].as<Types::Table*>()->metatable())) };
+    }
+
+    return { Types::Var::make(Types::Value::make_nil()) };
+}
+
+Types::VarList collectgarbage(Interpreter& interpreter, std::span<Types::Value const> arguments) {
+    std::string_view option = "collect";
+    if (!arguments.empty() && !arguments.front().is<Types::Nil>()) {
+        if (!arguments.front().is<Types::String>()) {
+            throw Exceptions::BadArgument(1, "collectgarbage", "string expected, got " + arguments.front().type_as_string());
+        }
+        option = arguments.front().as<Types::String>().view();
+    }
+
+    Types::Collector& collector = Types::Collector::instance();
+    if (option == "count") {
+        return { Types::Var::make(Types::Value::make_double(interpreter.memory_stats()._bytes / 1024.0)) };
+    } else if (option == "collect" || option == "step") {
+        collector.request(option == "collect");
+        return { Types::Var::make(Types::Value::make_int(0)) };
+    } else if (option == "stop" || option == "restart") {
+        interpreter.set_collecting(option == "restart");
+        return { Types::Var::make(Types::Value::make_int(0)) };
+    } else if (option == "isrunning") {
+        return { Types::Var::make(Types::Value::make_bool(interpreter.collecting())) };
+    } else if (option == "generational") {
+        return { Types::Var::make(Types::Value::make_string(Types::String("generational"))) };
+    }
+
+    throw Exceptions::BadArgument(1, "collectgarbage", "invalid option '" + std::string(option) + "'");
+}
+
+}
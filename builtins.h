@@ -0,0 +1,69 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "exceptions.h"
+#include "types.h"
+
+class Interpreter;
+
+/* Standard library functions implemented natively by the interpreter, as
+ * opposed to C++ functions registered through the type-safe abstraction.
+ */
+namespace Builtins {
+    void register_builtins(Interpreter& interpreter);
+
+    // string table, also used to resolve method calls on strings.
+    void register_string_library(Interpreter& interpreter);
+
+    // table table.
+    void register_table_library(Interpreter& interpreter);
+
+    /* Argument checks shared by the libraries. index is the 1-based position
+     * of the argument, as displayed in error messages. They raise
+     * Exceptions::BadArgument if the argument is absent or of the wrong type.
+     */
+
+    // Strings, or numbers converted to strings.
+    Types::String check_string(std::span<Types::Value const> arguments, size_t index, char const* function);
+
+    // Integers, or numbers and numeric strings with an integral value.
+    int check_int(std::span<Types::Value const> arguments, size_t index, char const* function);
+
+    // As check_int, but absent and nil arguments yield the default value.
+    int opt_int(std::span<Types::Value const> arguments, size_t index, char const* function, int value);
+
+    Types::Table* check_table(std::span<Types::Value const> arguments, size_t index, char const* function);
+
+    // select('#', ...) returns the number of extra arguments, select(n, ...)
+    // returns all the arguments after the n-th one (counting from the end if
+    // n is negative).
+    Types::VarList select(Interpreter& interpreter, std::span<Types::Value const> arguments);
+
+    // select called with a trailing ..., whose values come after arguments.
+    // It does not copy them: the count is the size of rest, and the tail is
+    // returned as a window into its storage.
+    Types::VarList select_elipsis(Interpreter& interpreter, std::span<Types::Value const> arguments, Types::Elipsis const& rest);
+
+    // pcall(f, ...) calls f with the other arguments. It returns true and
+    // the results of f, or false and the message of the error raised by f.
+    Types::VarList pcall(Interpreter& interpreter, std::span<Types::Value const> arguments);
+
+    // setmetatable(t, mt) sets the metatable of the table t to the table mt,
+    // or removes it if mt is nil, and returns t. Only __mode is supported.
+    Types::VarList setmetatable(Interpreter& interpreter, std::span<Types::Value const> arguments);
+
+    // getmetatable(t) returns the metatable of t, or nil.
+    Types::VarList getmetatable(Interpreter& interpreter, std::span<Types::Value const> arguments);
+
+    /* collectgarbage("count") returns the memory used by the interpreter, in
+     * kilobytes. "collect" and "step" run a major and a minor collection of
+     * the tables at the next safe point, "stop" and "restart" disable and
+     * enable the collections, and "isrunning" tells whether they are
+     * enabled. The collector is always generational: "generational" only
+     * returns the name of the mode.
+     */
+    Types::VarList collectgarbage(Interpreter& interpreter, std::span<Types::Value const> arguments);
+}
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <ranges>
+#include <variant>
+
+#include "collector.h"
+#include "exceptions.h"
+#include "memory.h"
+#include "shape.h"
+#include "types.h"
+
+namespace Types {
+
+namespace {
+    Table* table_of(Value& value) {
+        Table** table = std::get_if<Table*>(&value.value());
+        return table ? *table : nullptr;
+    }
+}
+
+// Never destroyed: tables may be released during static destruction.
+Collector& Collector::instance() {
+    static Collector* collector = new Collector();
+    return *collector;
+}
+
+void Collector::link(List& list, Table* table) {
+    table->_gc_previous = nullptr;
+    table->_gc_next = list._first;
+    if (list._first) {
+        list._first->_gc_previous = table;
+    }
+    list._first = table;
+    ++list._size;
+}
+
+void Collector::unlink(List& list, Table* table) {
+    if (table->_gc_previous) {
+        table->_gc_previous->_gc_next = table->_gc_next;
+    } else {
+        list._first = table->_gc_next;
+    }
+
+    if (table->_gc_next) {
+        table->_gc_next->_gc_previous = table->_gc_previous;
+    }
+
+    table->_gc_previous = nullptr;
+    table->_gc_next = nullptr;
+    --list._size;
+}
+
+template<typename F, typename G>
+void Collector::traverse(Table* table, F&& value, G&& entry) {
+    for (Value* v: table->_array) {
+        value(*v);
+    }
+
+    for (Value* v: std::views::values(table->_int_fields)) {
+        value(*v);
+    }
+
+    for (Value& v: std::views::values(table->_double_fields)) {
+        value(v);
+    }
+
+    for (Value& v: table->_bool_fields) {
+        value(v);
+    }
+
+    for (Value* v: table->_fields) {
+        value(*v);
+    }
+
+    table->_string_fields.for_each([&](String const&, Value& v) { value(v); });
+
+    for (Value& v: std::views::values(table->_function_fields)) {
+        value(v);
+    }
+
+    for (auto& [k, v]: table->_table_fields) {
+        entry(k, v);
+    }
+
+    for (Value& v: std::views::values(table->_userdata_fields)) {
+        value(v);
+    }
+
+    if (table->_metatable) {
+        value(*table->_metatable);
+    }
+}
+
+void Collector::strip(Table* table) {
+    Memory::Account::Scope scope(table->_account);
+    auto is_value = [](Value* value) { return value != nullptr; };
+    std::size_t values = std::ranges::count_if(table->_array, is_value) + table->_int_fields.size() + std::ranges::count_if(table->_fields, is_value) + is_value(table->_metatable);
+    Memory::credit(Memory::Kind::VALUE, values * sizeof(Value), values);
+    Memory::credit(Memory::Kind::TABLE, sizeof(Table));
+
+    // The garbage is forgotten by GC already: releasing the references to
+    // it does nothing.
+    auto release = [](Value& value) {
+        sGC->remove_reference(value.value());
+        value.value() = Nil();
+    };
+    traverse(table, release, [&](Table*, Value& value) { release(value); });
+
+    table->_string_fields.clear();
+    table->_shape->release();
+    table->_shape = nullptr;
+}
+
+void Collector::track(Table* table) {
+    table->_generation = YOUNG;
+    link(_young, table);
+}
+
+void Collector::untrack(Table* table) {
+    if (table->_generation == YOUNG) {
+        unlink(_young, table);
+    } else if (table->_generation == OLD) {
+        unlink(_old, table);
+    }
+
+    if (table->_remembered) {
+        std::erase(_remembered, table);
+        table->_remembered = false;
+    }
+
+    if (table->_weak_keys) {
+        std::erase(_weak_keys, table);
+    }
+
+    // Untracked tables are garbage, whose entries are no longer cleared.
+    table->_weak_keys = false;
+    table->_weak_values = false;
+    table->_generation = UNTRACKED;
+}
+
+void Collector::set_weak_keys(Table* table, bool weak) {
+    std::erase(_weak_keys, table);
+    if (weak) {
+        _weak_keys.push_back(table);
+    }
+}
+
+void Collector::erase_key(Function* key) {
+    for (Table* table: _weak_keys) {
+        table->_function_fields.erase(key);
+    }
+}
+
+void Collector::store_key(Table* table, Table* key) {
+    if (table->_generation == OLD && key->_generation == YOUNG && !table->_remembered) {
+        table->_remembered = true;
+        _remembered.push_back(table);
+    }
+}
+
+void Collector::collect() {
+    bool major = _major_requested;
+    _requested = false;
+    _major_requested = false;
+
+    if (!major) {
+        run(false);
+        major = _old._size > _major_threshold;
+    }
+
+    if (major) {
+        run(true);
+        _major_threshold = std::max(2 * _old._size, MinMajorThreshold);
+    }
+}
+
+void Collector::request(bool major) {
+    _requested = true;
+    _major_requested = _major_requested || major;
+}
+
+void Collector::run(bool major) {
+    auto collected = [major](Table* table) {
+        return table->_generation == YOUNG || (major && table->_generation == OLD);
+    };
+
+    std::vector<Table*> tables;
+    tables.reserve(_young._size + (major ? _old._size : 0));
+    for (Table* table = _young._first; table; table = table->_gc_next) {
+        tables.push_back(table);
+    }
+
+    if (major) {
+        for (Table* table = _old._first; table; table = table->_gc_next) {
+            tables.push_back(table);
+        }
+    }
+
+    // References from outside the collected tables: all of them, but the one
+    // that is never released and the ones held by collected tables.
+    for (Table* table: tables) {
+        table->_gc_references = static_cast<std::ptrdiff_t>(sGC->references(LuaValue(table))) - 1;
+        table->_gc_reachable = false;
+    }
+
+    auto subtract = [&](Value& value) {
+        Table* referenced = table_of(value);
+        if (referenced && collected(referenced)) {
+            --referenced->_gc_references;
+        }
+    };
+
+    for (Table* table: tables) {
+        traverse(table, subtract, [&](Table*, Value& value) { subtract(value); });
+    }
+
+    std::vector<Table*> stack;
+    auto reach = [&](Table* table) {
+        if (collected(table) && !table->_gc_reachable) {
+            table->_gc_reachable = true;
+            stack.push_back(table);
+        }
+    };
+
+    auto reach_value = [&](Value& value) {
+        if (Table* referenced = table_of(value)) {
+            reach(referenced);
+        }
+    };
+
+    // Whether key is alive, as far as the marking went.
+    auto marked = [&](Table* key) {
+        return !collected(key) || key->_gc_reachable;
+    };
+
+    for (Table* table: tables) {
+        if (table->_gc_references > 0) {
+            reach(table);
+        }
+    }
+
+    if (!major) {
+        for (Table* table: _remembered) {
+            traverse(table, [](Value&) { }, [&](Table* key, Value&) { reach(key); });
+        }
+    }
+
+    // Reached tables with weak keys only, whose values are reached when
+    // their keys are.
+    std::vector<Table*> ephemerons;
+    auto mark = [&]() {
+        while (!stack.empty()) {
+            Table* table = stack.back();
+            stack.pop_back();
+
+            if (table->_weak_values) {
+                // Values of weak tables are released, not scanned: only the
+                // metatable and the strong keys are references.
+                if (table->_metatable) {
+                    reach_value(*table->_metatable);
+                }
+
+                if (!table->_weak_keys) {
+                    for (Table* key: std::views::keys(table->_table_fields)) {
+                        reach(key);
+                    }
+                }
+            } else if (table->_weak_keys) {
+                ephemerons.push_back(table);
+                traverse(table, reach_value, [&](Table* key, Value& value) {
+                    if (marked(key)) {
+                        reach_value(value);
+                    }
+                });
+            } else {
+                traverse(table, reach_value, [&](Table* key, Value& value) {
+                    reach(key);
+                    reach_value(value);
+                });
+            }
+        }
+    };
+
+    mark();
+
+    // Keys marked after their ephemeron was scanned make their values
+    // reachable, which may mark more keys: scan again until nothing changes.
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (std::size_t i = 0; i < ephemerons.size(); ++i) {
+            for (auto& [key, value]: ephemerons[i]->_table_fields) {
+                Table* referenced = table_of(value);
+                if (referenced && marked(key) && !marked(referenced)) {
+                    reach(referenced);
+                    changed = true;
+                }
+            }
+
+            mark();
+        }
+    }
+
+    // Remove the entries of the reachable weak tables that refer to garbage.
+    // The references of weak values to it are not released: it is
+    // forgotten below.
+    for (Table* table: tables) {
+        if (!table->_gc_reachable || !(table->_weak_keys || table->_weak_values)) {
+            continue;
+        }
+
+        if (table->_weak_values) {
+            auto clear = [&](Value& value) {
+                if (Table* referenced = table_of(value); referenced && !marked(referenced)) {
+                    value.value() = Nil();
+                }
+            };
+            traverse(table, clear, [&](Table*, Value& value) { clear(value); });
+        }
+
+        std::erase_if(table->_table_fields, [&](auto const& entry) {
+            return (table->_weak_keys && !marked(entry.first)) || entry.second.template is<Nil>();
+        });
+    }
+
+    // Survivors are all old now: no old table has young keys anymore.
+    for (Table* table: _remembered) {
+        table->_remembered = false;
+    }
+    _remembered.clear();
+
+    std::vector<Table*> garbage;
+    for (Table* table: tables) {
+        if (!table->_gc_reachable) {
+            untrack(table);
+            garbage.push_back(table);
+        } else if (table->_generation == YOUNG) {
+            unlink(_young, table);
+            table->_generation = OLD;
+            link(_old, table);
+        }
+    }
+
+    // Forget all the garbage before deleting any: deleting a table releases
+    // its references, that would reach the tables already deleted.
+    for (Table* table: garbage) {
+        sGC->forget(LuaValue(table));
+    }
+
+    // Tables that do not fit in the queue of the Sweeper are deleted here.
+    std::size_t room = _sweeper.room();
+    std::vector<Table*> swept;
+    for (Table* table: garbage) {
+        if (swept.size() < room) {
+            strip(table);
+            swept.push_back(table);
+        } else {
+            Memory::Account::Scope scope(table->_account);
+            delete table;
+        }
+    }
+
+    ++(major ? _stats._major : _stats._minor);
+    _stats._freed += garbage.size();
+    _stats._swept += swept.size();
+
+    if (!swept.empty()) {
+        _sweeper.hand_off(std::move(swept));
+    }
+}
+
+std::vector<Table*> Collector::tables() const {
+    std::vector<Table*> tables;
+    tables.reserve(_young._size + _old._size);
+    for (List const* list: { &_young, &_old }) {
+        for (Table* table = list->_first; table; table = table->_gc_next) {
+            tables.push_back(table);
+        }
+    }
+
+    return tables;
+}
+
+Collector::Stats Collector::stats() const {
+    Stats stats = _stats;
+    stats._young = _young._size;
+    stats._old = _old._size;
+    return stats;
+}
+
+}
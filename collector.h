@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "sweeper.h"
+
+namespace Types {
+    class Function;
+    class Table;
+
+    /* Generational collector of tables. Tables made by Value::make_table
+     * hold one reference that no Value releases, so reference counting
+     * never frees them: the collector does, once they are no longer
+     * reachable.
+     *
+     * Tables start in the young generation, and the ones that survive a
+     * collection move to the old one. Minor collections only look at the
+     * young generation, and run every YoungThreshold new tables; major
+     * collections look at both, and run when the old generation doubled
+     * since the last one.
+     *
+     * A collection does not scan the roots. For each table of the
+     * collected generations, it subtracts from its reference count the
+     * references held by the other tables of these generations, and the
+     * one no Value releases. Tables with references left are referenced
+     * from elsewhere (a variable, a function, a Value on the native stack,
+     * an old table): they are alive, and so are the tables reachable from
+     * them. The other ones are freed.
+     *
+     * Tables used as keys are not referenced: when a young table becomes a
+     * key of an old one, the old one is remembered, and minor collections
+     * also look at the keys of the remembered tables.
+     *
+     * The interpreter holds pointers to fields without references while it
+     * evaluates an expression, so collections only run at safe points,
+     * when no Lua function is running. Like GC, the collector is shared by
+     * all the interpreters and is not synchronized.
+     *
+     * Tables whose metatable has a __mode (see Table::set_metatable) are
+     * weak. Their weak values are not followed, and a table with weak keys
+     * only is an ephemeron: the value of a table key is only followed once
+     * the key is reachable otherwise. When a collection frees a table, the
+     * entries of the surviving weak tables that refer to it are removed.
+     * Function keys of weak tables are removed when the function is
+     * released. Minor collections treat old tables as strong: entries of
+     * old weak tables are only removed by major collections.
+     *
+     * Unreachable tables are stripped (their references released, their
+     * memory credited) by the collection, and deleted by the Sweeper.
+     * Tables they referenced that are still alive are released right away.
+     */
+    class Collector {
+    public:
+        static constexpr std::size_t YoungThreshold = 1000;
+        static constexpr std::size_t MinMajorThreshold = 10000;
+
+        struct Stats {
+            std::size_t _young = 0; // Tables in the young generation
+            std::size_t _old = 0; // Tables in the old generation
+            std::size_t _minor = 0; // Minor collections run
+            std::size_t _major = 0; // Major collections run
+            std::size_t _freed = 0; // Tables freed by collections
+            std::size_t _swept = 0; // Tables of _freed deleted by the Sweeper
+        };
+
+        static Collector& instance();
+
+        // Add a table made by Value::make_table to the young generation.
+        void track(Table* table);
+        void untrack(Table* table);
+
+        // Write barrier of the keys: key was stored as a key of table.
+        void store_key(Table* table, Table* key);
+
+        // Keep the tables with weak keys, to remove released functions from
+        // their keys.
+        void set_weak_keys(Table* table, bool weak);
+
+        // Remove key from the keys of the tables with weak keys.
+        void erase_key(Function* key);
+
+        // Whether a collection is due, checked at safe points.
+        bool pending() const { return _requested || _young._size >= YoungThreshold; }
+
+        // Run the collection that is due.
+        void collect();
+
+        // Run a collection at the next safe point, of the whole heap if
+        // major is set.
+        void request(bool major);
+
+        // All the tables the collector tracks, young ones first.
+        std::vector<Table*> tables() const;
+
+        // Wait until the Sweeper deleted all the tables handed to it.
+        void finish_sweeping() { _sweeper.wait(); }
+
+        Stats stats() const;
+
+    private:
+        enum Generation : unsigned char {
+            UNTRACKED,
+            YOUNG,
+            OLD
+        };
+
+        struct List {
+            Table* _first = nullptr;
+            std::size_t _size = 0;
+        };
+
+        Collector() = default;
+
+        static void link(List& list, Table* table);
+        static void unlink(List& list, Table* table);
+
+        // Call value on the values of table, and entry on the keys and
+        // values of the fields with table keys.
+        template<typename F, typename G>
+        static void traverse(Table* table, F&& value, G&& entry);
+
+        /* Release all that table holds that the Sweeper cannot: the
+         * references of its values, its strings and its shape, and credit
+         * the current memory account for it. Leaves a table whose
+         * destruction only frees memory.
+         */
+        static void strip(Table* table);
+
+        // Collect the young generation, and the old one if major is set.
+        void run(bool major);
+
+        List _young;
+        List _old;
+        // Old tables that have young keys.
+        std::vector<Table*> _remembered;
+        // Tables with weak keys.
+        std::vector<Table*> _weak_keys;
+
+        // Size of the old generation above which a major collection runs.
+        std::size_t _major_threshold = MinMajorThreshold;
+
+        bool _requested = false;
+        bool _major_requested = false;
+
+        Stats _stats;
+
+        Sweeper _sweeper;
+    };
+}
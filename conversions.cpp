@@ -0,0 +1,131 @@
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <system_error>
+
+#include "conversions.h"
+
+namespace Conversions {
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+std::string_view trim(std::string_view string) {
+    while (!string.empty() && is_space(string.front())) {
+        string.remove_prefix(1);
+    }
+
+    while (!string.empty() && is_space(string.back())) {
+        string.remove_suffix(1);
+    }
+
+    return string;
+}
+
+// Strip the sign in front of a number. Returns true if it is negative.
+bool sign(std::string_view& string) {
+    if (!string.empty() && (string.front() == '-' || string.front() == '+')) {
+        bool negative = string.front() == '-';
+        string.remove_prefix(1);
+        return negative;
+    }
+
+    return false;
+}
+
+// Strip the 0x / 0X prefix of an hexadecimal number.
+bool hexadecimal(std::string_view& string) {
+    if (string.size() > 2 && string[0] == '0' && (string[1] == 'x' || string[1] == 'X')) {
+        string.remove_prefix(2);
+        return true;
+    }
+
+    return false;
+}
+
+template<typename T, typename... Args>
+bool parse(std::string_view string, T& value, Args... args) {
+    char const* end = string.data() + string.size();
+    auto [ptr, error] = std::from_chars(string.data(), end, value, args...);
+    return error == std::errc() && ptr == end;
+}
+
+}
+
+std::optional<int> to_int(std::string_view string) {
+    string = trim(string);
+    bool negative = sign(string);
+    bool hex = hexadecimal(string);
+
+    // Parse the magnitude, which does not fit in an int for INT_MIN.
+    long long magnitude;
+    if (string.empty() || string.front() == '-' || !parse(string, magnitude, hex ? 16 : 10)) {
+        return std::nullopt;
+    }
+
+    long long value = negative ? -magnitude : magnitude;
+    if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+        return std::nullopt;
+    }
+
+    return static_cast<int>(value);
+}
+
+std::optional<double> to_double(std::string_view string) {
+    string = trim(string);
+    bool negative = sign(string);
+    bool hex = hexadecimal(string);
+
+    // from_chars also reads inf and nan, which are not Lua numbers.
+    if (string.empty() || !(std::isxdigit(static_cast<unsigned char>(string.front())) || string.front() == '.')) {
+        return std::nullopt;
+    }
+
+    double value;
+    char const* end = string.data() + string.size();
+    auto [ptr, error] = std::from_chars(string.data(), end, value, hex ? std::chars_format::hex : std::chars_format::general);
+    if (ptr != end || (error != std::errc() && error != std::errc::result_out_of_range)) {
+        return std::nullopt;
+    }
+
+    // Out of range numbers are well formed, but from_chars does not give
+    // their value: strtod gives HUGE_VAL when they overflow, and 0 or the
+    // nearest denormal when they underflow, as in Lua.
+    if (error == std::errc::result_out_of_range) {
+        value = std::strtod((hex ? "0x" + std::string(string) : std::string(string)).c_str(), nullptr);
+    }
+
+    return negative ? -value : value;
+}
+
+void append(std::string& dest, int value) {
+    char buffer[std::numeric_limits<int>::digits10 + 3];
+    auto [ptr, _] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    dest.append(buffer, ptr);
+}
+
+void append(std::string& dest, double value) {
+    // Sign, 6 significant digits, point, exponent: always fits.
+    char buffer[32];
+    auto [ptr, _] = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+    dest.append(buffer, ptr);
+}
+
+std::string to_string(int value) {
+    std::string result;
+    append(result, value);
+    return result;
+}
+
+std::string to_string(double value) {
+    std::string result;
+    append(result, value);
+    return result;
+}
+
+}
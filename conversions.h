@@ -0,0 +1,30 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+/* Conversions between numbers and strings. They are built on from_chars /
+ * to_chars: no locale, no allocation besides the result, and no exception
+ * to signal that a string is not a number.
+ */
+namespace Conversions {
+    // Integer written in decimal, or in hexadecimal with a 0x prefix,
+    // surrounded by optional whitespace. Empty if the string is not an
+    // integer or if it does not fit in an int.
+    std::optional<int> to_int(std::string_view string);
+
+    // Any number, integer or floating point, surrounded by optional
+    // whitespace. Empty if the string is not a number.
+    std::optional<double> to_double(std::string_view string);
+
+    // Same format as printf("%d").
+    void append(std::string& dest, int value);
+
+    // Same format as printf("%g"), which is what the interpreter has always
+    // used to display doubles.
+    void append(std::string& dest, double value);
+
+    std::string to_string(int value);
+    std::string to_string(double value);
+}
@@ -80,6 +80,24 @@ ForInBadType::ForInBadType(const std::string &type) {
     _error = "First result of expression of `for in` is " + type + ", expected function\n";
 }
 
+BadArgument::BadArgument(int index, std::string const& function, std::string const& detail) {
+    std::ostringstream error;
+    error << "Bad argument #" << index << " to " << function << " (" << detail << ")" << std::endl;
+    _error = error.str();
+}
+
+MalformedPattern::MalformedPattern(std::string const& pattern, std::string const& detail) {
+    std::ostringstream error;
+    error << "Malformed pattern \"" << pattern << "\" (" << detail << ")" << std::endl;
+    _error = error.str();
+}
+
+MemoryLimit::MemoryLimit(std::size_t limit) {
+    std::ostringstream error;
+    error << "Not enough memory (limit of " << limit << " bytes reached)" << std::endl;
+    _error = error.str();
+}
+
 namespace CLua {
 
 const char* BindOverflow::what() const noexcept {
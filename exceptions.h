@@ -97,6 +97,22 @@ public:
     ForInBadType(std::string const& type);
 };
 
+class BadArgument : public string_exception {
+public:
+    BadArgument(int index, std::string const& function, std::string const& detail);
+};
+
+class MalformedPattern : public string_exception {
+public:
+    MalformedPattern(std::string const& pattern, std::string const& detail);
+};
+
+// An allocation would take the memory used by the interpreter over its limit.
+class MemoryLimit : public string_exception {
+public:
+    MemoryLimit(std::size_t limit);
+};
+
 namespace CLua {
 
 class BindOverflow : public std::exception {
@@ -140,15 +156,44 @@ private:
 
 class Return : public std::exception {
 public:
-    Return(std::vector<Types::Var>&& values) : _values(std::move(values)) {
+    Return(Types::VarList&& values) : _values(std::move(values)) {
+
+    }
+
+    Types::VarList const& get() const { return _values; }
+
+    const char* what() const noexcept { return ""; }
+
+private:
+    Types::VarList _values;
+};
 
+/* Thrown by a return statement whose only expression is a function call.
+ * The callee and its arguments are evaluated in the frame of the caller, then
+ * the frame is released and reused to perform the call, so that tail calls
+ * run in constant stack.
+ */
+class TailCall : public std::exception {
+public:
+    TailCall(Types::Function* function, Types::ValueList&& arguments, Types::Elipsis const& rest) : _arguments(std::move(arguments)), _rest(rest) {
+        // Keep the callee alive: the frame it was found in is released
+        // before it is called.
+        _callee.value() = function;
+        sGC->add_reference(_callee.value());
     }
 
-    std::vector<Types::Var> const& get() const { return _values; }
+    Types::Value const& callee() const { return _callee; }
+
+    Types::ValueList& arguments() { return _arguments; }
+
+    // Trailing ... of the arguments.
+    Types::Elipsis const& rest() const { return _rest; }
 
     const char* what() const noexcept { return ""; }
 
 private:
-    std::vector<Types::Var> _values;
+    Types::Value _callee;
+    Types::ValueList _arguments;
+    Types::Elipsis _rest;
 };
 }
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <new>
+
+#include "exceptions.h"
+#include "field_map.h"
+#include "memory.h"
+#include "types.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FIELD_MAP_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Types {
+
+struct FieldMap::Entry {
+    String _key;
+    Value _value;
+};
+
+struct FieldMap::Chunk {
+    Chunk* _next;
+    std::size_t _capacity;
+    std::size_t _size;
+
+    Entry* entries() { return reinterpret_cast<Entry*>(this + 1); }
+};
+
+FieldMap::~FieldMap() {
+    clear();
+}
+
+void FieldMap::clear() {
+    Memory::credit(Memory::Kind::TABLE, memory(), 0);
+
+    Chunk* chunk = _first;
+    while (chunk) {
+        Chunk* next = chunk->_next;
+        std::destroy_n(chunk->entries(), chunk->_size);
+        ::operator delete(chunk);
+        chunk = next;
+    }
+
+    ::operator delete(_control);
+
+    _control = nullptr;
+    _slots = nullptr;
+    _capacity = 0;
+    _size = 0;
+    _first = nullptr;
+    _last = nullptr;
+}
+
+std::uint32_t FieldMap::match(std::int8_t const* control, std::int8_t byte) {
+#ifdef FIELD_MAP_X86
+    __m128i group = _mm_loadu_si128(reinterpret_cast<__m128i const*>(control));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte)));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GroupSize; ++i) {
+        mask |= static_cast<std::uint32_t>(control[i] == byte) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Groups are probed in triangular order (g, g + 1, g + 3, g + 6...), that
+ * visits all of them when their number is a power of two. The index is
+ * never full, so the probing ends on a group with an empty slot.
+ */
+Value* FieldMap::find(String const& key) const {
+    if (_size == 0) {
+        return nullptr;
+    }
+
+    std::size_t hash = key.hash();
+    std::size_t mask = groups() - 1;
+    std::size_t g = group(hash) & mask;
+    for (std::size_t step = 1; ; ++step) {
+        std::int8_t const* controls = _control + g * GroupSize;
+        for (std::uint32_t candidates = match(controls, control(hash)); candidates; candidates &= candidates - 1) {
+            Entry* entry = _slots[g * GroupSize + std::countr_zero(candidates)];
+            if (entry->_key == key) {
+                return &entry->_value;
+            }
+        }
+
+        if (match(controls, Empty)) {
+            return nullptr;
+        }
+
+        g = (g + step) & mask;
+    }
+}
+
+std::size_t FieldMap::free_slot(std::size_t hash) const {
+    std::size_t mask = groups() - 1;
+    std::size_t g = group(hash) & mask;
+    for (std::size_t step = 1; ; ++step) {
+        if (std::uint32_t empty = match(_control + g * GroupSize, Empty)) {
+            return g * GroupSize + std::countr_zero(empty);
+        }
+
+        g = (g + step) & mask;
+    }
+}
+
+Value& FieldMap::insert(String const& key) {
+    if (Value* value = find(key)) {
+        return *value;
+    }
+
+    if (_capacity == 0 || overloaded(_size + 1, _capacity)) {
+        rehash(std::max(_capacity * 2, MinCapacity));
+    }
+
+    Entry& entry = allocate(0);
+    new (&entry) Entry { key, Value() };
+    ++_last->_size;
+
+    std::size_t hash = key.hash();
+    std::size_t slot = free_slot(hash);
+    _control[slot] = control(hash);
+    _slots[slot] = &entry;
+    ++_size;
+    return entry._value;
+}
+
+void FieldMap::reserve(std::size_t size) {
+    if (size <= _size) {
+        return;
+    }
+
+    std::size_t capacity = std::max(_capacity, MinCapacity);
+    while (overloaded(size, capacity)) {
+        capacity *= 2;
+    }
+    if (capacity != _capacity) {
+        rehash(capacity);
+    }
+
+    allocate(size - _size);
+}
+
+std::size_t FieldMap::memory() const {
+    std::size_t bytes = index_memory(_capacity);
+    for (Chunk* chunk = _first; chunk; chunk = chunk->_next) {
+        bytes += sizeof(Chunk) + chunk->_capacity * sizeof(Entry);
+    }
+
+    return bytes;
+}
+
+void FieldMap::for_each(void (*visit)(String const&, Value&, void*), void* context) const {
+    for (Chunk* chunk = _first; chunk; chunk = chunk->_next) {
+        for (std::size_t i = 0; i < chunk->_size; ++i) {
+            visit(chunk->entries()[i]._key, chunk->entries()[i]._value, context);
+        }
+    }
+}
+
+void FieldMap::rehash(std::size_t capacity) {
+    std::int8_t* old_control = _control;
+    Entry** old_slots = _slots;
+    std::size_t old_capacity = _capacity;
+
+    Memory::charge(Memory::Kind::TABLE, index_memory(capacity), 0);
+    _capacity = capacity;
+    void* memory = ::operator new(controls() + capacity * sizeof(Entry*));
+    _control = static_cast<std::int8_t*>(memory);
+    _slots = reinterpret_cast<Entry**>(_control + controls());
+    std::memset(_control, Empty, capacity);
+    std::memset(_control + capacity, Padding, controls() - capacity);
+
+    for (std::size_t i = 0; i < old_capacity; ++i) {
+        if (old_control[i] != Empty) {
+            std::size_t hash = old_slots[i]->_key.hash();
+            std::size_t slot = free_slot(hash);
+            _control[slot] = control(hash);
+            _slots[slot] = old_slots[i];
+        }
+    }
+
+    ::operator delete(old_control);
+    Memory::credit(Memory::Kind::TABLE, index_memory(old_capacity), 0);
+}
+
+/* Room for the next entry, in the last chunk if it has some. Otherwise a new
+ * chunk is added, of at least reserve entries. Chunks grow the number of
+ * entries by half, so that there are few of them, and at most a third of
+ * the entries are unused.
+ */
+FieldMap::Entry& FieldMap::allocate(std::size_t reserve) {
+    if (_last && _last->_size + reserve <= _last->_capacity && _last->_size < _last->_capacity) {
+        return _last->entries()[_last->_size];
+    }
+
+    std::size_t capacity = std::max({ reserve, _size / 2, std::size_t(4) });
+    Memory::charge(Memory::Kind::TABLE, sizeof(Chunk) + capacity * sizeof(Entry), 0);
+    Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + capacity * sizeof(Entry)));
+    chunk->_next = nullptr;
+    chunk->_capacity = capacity;
+    chunk->_size = 0;
+
+    if (_last) {
+        _last->_next = chunk;
+    } else {
+        _first = chunk;
+    }
+    _last = chunk;
+
+    return chunk->entries()[0];
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "interned_string.h"
+
+namespace Types {
+    class Value;
+
+    /* String keyed fields of a table. The index is an open addressing hash
+     * table in the layout of SwissTable: one control byte per slot, holding
+     * 7 bits of the hash of the key of the slot, or Empty. Lookups compare a
+     * group of 16 control bytes at once with the hash, and only look at the
+     * keys of the slots that match.
+     *
+     * The keys and values themselves are stored together, in the order they
+     * were inserted, in chunks that never move: the interpreter holds on to
+     * the Value& of a field while it evaluates the right hand side of an
+     * assignment, which may add fields to the same table. The slots point
+     * to them.
+     *
+     * Fields are never removed, a field set to nil keeps its entry.
+     */
+    class FieldMap {
+    public:
+        FieldMap() = default;
+        FieldMap(FieldMap const&) = delete;
+        ~FieldMap();
+
+        FieldMap& operator=(FieldMap const&) = delete;
+
+        // Value of the key, or null if there is none.
+        Value* find(String const& key) const;
+
+        // Value of the key, inserted as nil if there is none.
+        Value& insert(String const& key);
+
+        // Remove all the fields and release the index and the entries.
+        void clear();
+
+        // Make room for size fields without further allocation.
+        void reserve(std::size_t size);
+
+        std::size_t size() const { return _size; }
+
+        // Call visit on the key and the value of each field, in insertion
+        // order.
+        template<typename F>
+        void for_each(F&& visit) const {
+            for_each([](String const& key, Value& value, void* context) { (*static_cast<std::remove_reference_t<F>*>(context))(key, value); }, &visit);
+        }
+
+        // Bytes allocated for the index and the entries.
+        std::size_t memory() const;
+
+    private:
+        struct Entry;
+        struct Chunk;
+
+        static constexpr std::size_t GroupSize = 16;
+        static constexpr std::int8_t Empty = -128;
+        // Control bytes past the slots of an index smaller than a group.
+        static constexpr std::int8_t Padding = -1;
+
+        // Small tables have a single group of 8 slots.
+        static constexpr std::size_t MinCapacity = 8;
+
+        // Slots are added when more than 7 out of 8 would be used.
+        static bool overloaded(std::size_t size, std::size_t capacity) { return size * 8 > capacity * 7; }
+
+        static std::size_t control(std::size_t hash) { return hash & 0x7F; }
+        static std::size_t group(std::size_t hash) { return hash >> 7; }
+
+        // Bit i is set if the control byte i of the group at control equals
+        // byte.
+        static std::uint32_t match(std::int8_t const* control, std::int8_t byte);
+
+        // Slot of the first empty control byte in the probe sequence of hash.
+        std::size_t free_slot(std::size_t hash) const;
+
+        void rehash(std::size_t capacity);
+
+        Entry& allocate(std::size_t reserve);
+
+        void for_each(void (*visit)(String const&, Value&, void*), void* context) const;
+
+        // Bytes of an index of capacity slots.
+        static std::size_t index_memory(std::size_t capacity) { return capacity ? std::max(capacity, GroupSize) + capacity * sizeof(Entry*) : 0; }
+
+        std::size_t groups() const { return _capacity < GroupSize ? 1 : _capacity / GroupSize; }
+        std::size_t controls() const { return groups() * GroupSize; }
+
+        // Index: the control bytes of the groups, followed by _capacity
+        // slots.
+        std::int8_t* _control = nullptr;
+        Entry** _slots = nullptr;
+        std::size_t _capacity = 0;
+        std::size_t _size = 0;
+
+        // Entries, in chunks linked from the first one. Only the last one
+        // has room left.
+        Chunk* _first = nullptr;
+        Chunk* _last = nullptr;
+    };
+}
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Reads a heap snapshot written by Interpreter::write_heap_snapshot (see
+ * Types::HeapSnapshot for the format), and lists the objects that retain the
+ * most memory: their own, and the memory of the objects they dominate, that
+ * would be released with them. An object dominates another if all the paths
+ * from the roots to the other go through it.
+ *
+ * Usage: heap_analyzer <snapshot> [count]
+ */
+
+namespace {
+
+constexpr std::size_t None = static_cast<std::size_t>(-1);
+
+struct Edge {
+    std::size_t _to;
+    std::string _name;
+};
+
+struct Node {
+    std::string _kind;
+    std::size_t _bytes = 0;
+    std::string _name;
+    std::vector<Edge> _edges;
+    std::vector<std::size_t> _predecessors;
+
+    // Position in the reverse postorder of the search from the root, None if
+    // the node is not reachable.
+    std::size_t _order = None;
+    // Node and edge the search reached the node through.
+    std::size_t _parent = None;
+    std::string const* _parent_edge = nullptr;
+    std::size_t _dominator = None;
+    std::size_t _retained = 0;
+};
+
+// Name as written by Types::HeapSnapshot, with its backslashes and line
+// breaks escaped.
+std::string unescape(std::string const& name) {
+    std::string result;
+    result.reserve(name.size());
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        if (name[i] != '\\' || i + 1 == name.size()) {
+            result += name[i];
+            continue;
+        }
+
+        char c = name[++i];
+        result += c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+    }
+    return result;
+}
+
+std::vector<Node> read(std::string const& path) {
+    std::ifstream stream(path);
+    if (!stream) {
+        throw std::runtime_error("Unable to open heap snapshot " + path);
+    }
+
+    std::string line;
+    if (!std::getline(stream, line) || line != "lua-heap-snapshot 1") {
+        throw std::runtime_error(path + " is not a heap snapshot");
+    }
+
+    std::vector<Node> nodes;
+    while (std::getline(stream, line)) {
+        std::istringstream record(line);
+        char type = 0;
+        std::size_t first = 0;
+        record >> type >> first;
+        if (type == 'N') {
+            Node node;
+            record >> node._kind >> node._bytes;
+            record.get();
+            std::getline(record, node._name);
+            node._name = unescape(node._name);
+            if (first != nodes.size()) {
+                throw std::runtime_error("Nodes out of order in " + path);
+            }
+            nodes.push_back(std::move(node));
+        } else if (type == 'E') {
+            Edge edge;
+            record >> edge._to;
+            record.get();
+            std::getline(record, edge._name);
+            edge._name = unescape(edge._name);
+            if (first >= nodes.size() || edge._to >= nodes.size()) {
+                throw std::runtime_error("Edge to an unknown node in " + path);
+            }
+            nodes[edge._to]._predecessors.push_back(first);
+            nodes[first]._edges.push_back(std::move(edge));
+        } else {
+            throw std::runtime_error("Unknown record in " + path + ": " + line);
+        }
+    }
+
+    if (nodes.empty()) {
+        throw std::runtime_error(path + " has no root");
+    }
+
+    return nodes;
+}
+
+// Nodes reachable from the root, in reverse postorder.
+std::vector<std::size_t> search(std::vector<Node>& nodes) {
+    std::vector<std::size_t> postorder;
+    std::vector<bool> seen(nodes.size(), false);
+    // Node, and next edge to follow.
+    std::vector<std::pair<std::size_t, std::size_t>> stack = { { 0, 0 } };
+    seen[0] = true;
+    while (!stack.empty()) {
+        auto& [id, next] = stack.back();
+        if (next == nodes[id]._edges.size()) {
+            postorder.push_back(id);
+            stack.pop_back();
+            continue;
+        }
+
+        Edge const& edge = nodes[id]._edges[next++];
+        if (!seen[edge._to]) {
+            seen[edge._to] = true;
+            nodes[edge._to]._parent = id;
+            nodes[edge._to]._parent_edge = &edge._name;
+            stack.emplace_back(edge._to, 0);
+        }
+    }
+
+    std::reverse(postorder.begin(), postorder.end());
+    for (std::size_t i = 0; i < postorder.size(); ++i) {
+        nodes[postorder[i]]._order = i;
+    }
+
+    return postorder;
+}
+
+/* Immediate dominators, with the iterative algorithm of Cooper, Harvey and
+ * Kennedy ("A Simple, Fast Dominance Algorithm"): a node's dominator is the
+ * common dominator of its predecessors, computed until nothing changes.
+ */
+void dominators(std::vector<Node>& nodes, std::vector<std::size_t> const& order) {
+    auto intersect = [&](std::size_t a, std::size_t b) {
+        while (a != b) {
+            while (nodes[a]._order > nodes[b]._order) {
+                a = nodes[a]._dominator;
+            }
+            while (nodes[b]._order > nodes[a]._order) {
+                b = nodes[b]._dominator;
+            }
+        }
+        return a;
+    };
+
+    nodes[0]._dominator = 0;
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (std::size_t id: order) {
+            if (id == 0) {
+                continue;
+            }
+
+            std::size_t dominator = None;
+            for (std::size_t predecessor: nodes[id]._predecessors) {
+                if (nodes[predecessor]._dominator == None) {
+                    continue;
+                }
+                dominator = dominator == None ? predecessor : intersect(predecessor, dominator);
+            }
+
+            if (nodes[id]._dominator != dominator) {
+                nodes[id]._dominator = dominator;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Name on a single line of the report.
+std::string printable(std::string const& name) {
+    std::string result;
+    for (char c: name) {
+        result += c == '\n' ? "\\n" : c == '\r' ? "\\r" : std::string(1, c);
+    }
+    return result;
+}
+
+// Edges from the root to the node, as followed by the search.
+std::string retaining_path(std::vector<Node> const& nodes, std::size_t id) {
+    std::vector<std::string const*> edges;
+    for (; id != 0; id = nodes[id]._parent) {
+        edges.push_back(nodes[id]._parent_edge);
+    }
+
+    std::string path;
+    for (auto edge = edges.rbegin(); edge != edges.rend(); ++edge) {
+        path += (path.empty() ? "" : " -> ") + printable(**edge);
+    }
+    return path;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <snapshot> [count]" << std::endl;
+        return 1;
+    }
+
+    std::size_t count = argc > 2 ? std::stoul(argv[2]) : 20;
+
+    try {
+        std::vector<Node> nodes = read(argv[1]);
+        std::vector<std::size_t> order = search(nodes);
+        dominators(nodes, order);
+
+        for (auto id = order.rbegin(); id != order.rend(); ++id) {
+            Node& node = nodes[*id];
+            node._retained += node._bytes;
+            if (*id != 0) {
+                nodes[node._dominator]._retained += node._retained;
+            }
+        }
+
+        std::size_t unreachable = 0;
+        std::size_t unreachable_bytes = 0;
+        for (Node const& node: nodes) {
+            if (node._order == None) {
+                ++unreachable;
+                unreachable_bytes += node._bytes;
+            }
+        }
+
+        std::cout << nodes.size() << " nodes, " << nodes[0]._retained << " bytes reachable from the roots" << std::endl;
+        std::cout << unreachable << " nodes, " << unreachable_bytes << " bytes unreachable (held by native code, or not collected yet)" << std::endl;
+        std::cout << std::endl;
+
+        std::vector<std::size_t> objects;
+        for (std::size_t id: order) {
+            if (nodes[id]._kind != "root") {
+                objects.push_back(id);
+            }
+        }
+
+        count = std::min(count, objects.size());
+        std::partial_sort(objects.begin(), objects.begin() + count, objects.end(), [&](std::size_t a, std::size_t b) {
+            return nodes[a]._retained > nodes[b]._retained;
+        });
+
+        std::cout << "retained\tself\tkind\tname\tretaining path" << std::endl;
+        for (std::size_t i = 0; i < count; ++i) {
+            Node const& node = nodes[objects[i]];
+            std::cout << node._retained << "\t" << node._bytes << "\t" << node._kind << "\t" << printable(node._name) << "\t" << retaining_path(nodes, objects[i]) << std::endl;
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <ranges>
+#include <variant>
+
+#include "collector.h"
+#include "exceptions.h"
+#include "heap_snapshot.h"
+#include "shape.h"
+#include "types.h"
+
+namespace Types {
+
+namespace {
+    // Strings longer than this are cut in the names of their nodes.
+    constexpr std::size_t MaxStringName = 40;
+}
+
+HeapSnapshot::HeapSnapshot() {
+    add_node("root", 0, "(roots)");
+}
+
+std::size_t HeapSnapshot::add_group(std::string const& name) {
+    std::size_t id = add_node("root", 0, name);
+    _edges.push_back({ 0, id, name });
+    return id;
+}
+
+void HeapSnapshot::add_root(std::size_t group, std::string const& name, LuaValue const& object) {
+    add_edge(group, object, name);
+}
+
+void HeapSnapshot::write(std::ostream& stream) {
+    auto follow_all = [this]() {
+        std::size_t table = 0;
+        std::size_t function = 0;
+        while (table < _tables.size() || function < _functions.size()) {
+            // Copies: following adds to the vectors.
+            if (table < _tables.size()) {
+                auto [object, id] = _tables[table++];
+                follow(object, id);
+            } else {
+                auto [object, id] = _functions[function++];
+                follow(object, id);
+            }
+        }
+    };
+
+    follow_all();
+
+    for (Table* table: Collector::instance().tables()) {
+        if (!_ids.contains(table)) {
+            std::size_t id = add_node("table", memory(table), "table (unreachable)");
+            _ids.emplace(table, id);
+            _tables.emplace_back(table, id);
+        }
+    }
+
+    follow_all();
+
+    stream << "lua-heap-snapshot 1\n";
+    for (std::size_t id = 0; id < _nodes.size(); ++id) {
+        Node const& node = _nodes[id];
+        stream << "N " << id << " " << node._kind << " " << node._bytes << " ";
+        escape(stream, node._name);
+        stream << "\n";
+    }
+
+    for (Edge const& edge: _edges) {
+        stream << "E " << edge._from << " " << edge._to << " ";
+        escape(stream, edge._name);
+        stream << "\n";
+    }
+}
+
+std::size_t HeapSnapshot::node(LuaValue const& object) {
+    if (Table* const* table = std::get_if<Table*>(&object)) {
+        auto [iter, inserted] = _ids.try_emplace(*table, _nodes.size());
+        if (inserted) {
+            add_node("table", memory(*table), "table");
+            _tables.emplace_back(*table, iter->second);
+        }
+        return iter->second;
+    } else if (Function* const* function = std::get_if<Function*>(&object)) {
+        auto [iter, inserted] = _ids.try_emplace(*function, _nodes.size());
+        if (inserted) {
+            std::string name = "native function";
+            if ((*function)->is_pure()) {
+                name = "function(";
+                for (std::string const& parameter: (*function)->formal_parameters()) {
+                    name += (name.back() == '(' ? "" : ", ") + parameter;
+                }
+                name += ")";
+            }
+
+            add_node("function", sizeof(Function), std::move(name));
+            _functions.emplace_back(*function, iter->second);
+        }
+        return iter->second;
+    } else if (String const* string = std::get_if<String>(&object)) {
+        auto [iter, inserted] = _strings.try_emplace({ string->buffer(), string->offset(), string->size() }, _nodes.size());
+        if (inserted) {
+            std::string name = "\"" + std::string(string->view().substr(0, MaxStringName)) + (string->size() > MaxStringName ? "...\"" : "\"");
+            add_node("string", string->size(), std::move(name));
+        }
+        return iter->second;
+    }
+
+    return 0;
+}
+
+std::size_t HeapSnapshot::add_node(char const* kind, std::size_t bytes, std::string name) {
+    _nodes.push_back({ kind, bytes, std::move(name) });
+    return _nodes.size() - 1;
+}
+
+void HeapSnapshot::add_edge(std::size_t from, LuaValue const& object, std::string name) {
+    if (std::size_t to = node(object)) {
+        _edges.push_back({ from, to, std::move(name) });
+    }
+}
+
+// Weak references are left out: they do not retain what they reference.
+void HeapSnapshot::follow(Table* table, std::size_t id) {
+    auto field = [&](Value const& value, std::string name) {
+        if (!(table->_weak_values && value.is<Table*>())) {
+            add_edge(id, value.value(), std::move(name));
+        }
+    };
+
+    for (std::size_t i = 0; i < table->_array.size(); ++i) {
+        field(*table->_array[i], "[" + std::to_string(i + 1) + "]");
+    }
+
+    for (auto const& [key, value]: table->_int_fields) {
+        field(*value, "[" + std::to_string(key) + "]");
+    }
+
+    for (auto const& [key, value]: table->_double_fields) {
+        field(value, "[" + Value::make_double(key).as_string() + "]");
+    }
+
+    field(table->_bool_fields[0], "[false]");
+    field(table->_bool_fields[1], "[true]");
+
+    for (std::size_t slot = 0; slot < table->_fields.size(); ++slot) {
+        field(*table->_fields[slot], "." + std::string(table->_shape->key(slot).view()));
+    }
+
+    table->_string_fields.for_each([&](String const& key, Value& value) {
+        field(value, "." + std::string(key.view()));
+    });
+
+    // Function keys hold no reference: the ones that are no longer
+    // referenced anywhere else are released, and must not be read.
+    for (auto const& [key, value]: table->_function_fields) {
+        if (!table->_weak_keys && sGC->references(LuaValue(key)) != 0) {
+            add_edge(id, LuaValue(key), "(key)");
+        }
+        field(value, "[function]");
+    }
+
+    for (auto const& [key, value]: table->_table_fields) {
+        if (!table->_weak_keys) {
+            add_edge(id, LuaValue(key), "(key)");
+        }
+        field(value, "[table]");
+    }
+
+    for (Value const& value: std::views::values(table->_userdata_fields)) {
+        field(value, "[userdata]");
+    }
+
+    if (table->_metatable) {
+        add_edge(id, table->_metatable->value(), "(metatable)");
+    }
+}
+
+void HeapSnapshot::follow(Function* function, std::size_t id) {
+    if (function->is_pure()) {
+        for (auto const& [name, value]: function->closure()) {
+            add_edge(id, value->value(), name);
+        }
+    } else if (function->is_native()) {
+        if (Value const* state = function->native_state()) {
+            add_edge(id, state->value(), "(state)");
+        }
+    }
+}
+
+// Bytes of the table, its heap Values and the storage of its fields, not
+// counting the overhead of the allocator.
+std::size_t HeapSnapshot::memory(Table* table) {
+    std::size_t values = std::ranges::count_if(table->_array, [](Value* value) { return value != nullptr; }) + table->_int_fields.size() + table->_fields.size() + (table->_metatable != nullptr);
+    return sizeof(Table) + values * sizeof(Value)
+        + table->_array.capacity() * sizeof(Value*)
+        + table->_fields.capacity() * sizeof(Value*)
+        + table->_bool_fields.capacity() * sizeof(Value)
+        + table->_int_fields.size() * sizeof(std::pair<int const, Value*>)
+        + table->_double_fields.size() * sizeof(std::pair<double const, Value>)
+        + table->_function_fields.size() * sizeof(std::pair<Function* const, Value>)
+        + table->_table_fields.size() * sizeof(std::pair<Table* const, Value>)
+        + table->_userdata_fields.size() * sizeof(std::pair<Userdata* const, Value>)
+        + table->_string_fields.memory();
+}
+
+void HeapSnapshot::escape(std::ostream& stream, std::string const& name) {
+    for (char c: name) {
+        if (c == '\\') {
+            stream << "\\\\";
+        } else if (c == '\n') {
+            stream << "\\n";
+        } else if (c == '\r') {
+            stream << "\\r";
+        } else {
+            stream << c;
+        }
+    }
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace Types {
+    /* Graph of the objects reachable from the roots of an interpreter, to
+     * find out which ones hold on to memory. Nodes are tables, functions and
+     * strings, plus one node per group of roots (the globals, each frame of
+     * locals...) under node 0. Edges go from an object to the objects it
+     * references, named after the field, upvalue or variable holding them.
+     *
+     * Tables that are tracked by the Collector but not reachable from the
+     * roots are nodes without edges to them: they are referenced from
+     * native code, or garbage not collected yet.
+     *
+     * The snapshot is written as text, one record per line:
+     *
+     *     lua-heap-snapshot 1
+     *     N <id> <kind> <bytes> <name>
+     *     E <from> <to> <name>
+     *
+     * with all the nodes before the edges. kind is one of root, table,
+     * function or string, bytes the memory used by the object itself. Names
+     * run to the end of the line; backslashes and line breaks in them are
+     * escaped. heap_analyzer reads this format.
+     */
+    class HeapSnapshot {
+    public:
+        HeapSnapshot();
+
+        // Add a group of roots under node 0, named name. Returns its id.
+        std::size_t add_group(std::string const& name);
+
+        // Add object as a root of the group, held under name.
+        void add_root(std::size_t group, std::string const& name, LuaValue const& object);
+
+        // Follow the references of the objects reached from the roots, add
+        // the unreachable tables, and write the snapshot.
+        void write(std::ostream& stream);
+
+    private:
+        struct Node {
+            char const* _kind;
+            std::size_t _bytes;
+            std::string _name;
+        };
+
+        struct Edge {
+            std::size_t _from;
+            std::size_t _to;
+            std::string _name;
+        };
+
+        // Node of object, 0 if it is not a table, a function or a string.
+        // Objects seen for the first time are queued to be followed.
+        std::size_t node(LuaValue const& object);
+
+        std::size_t add_node(char const* kind, std::size_t bytes, std::string name);
+        void add_edge(std::size_t from, LuaValue const& object, std::string name);
+
+        void follow(Table* table, std::size_t id);
+        void follow(Function* function, std::size_t id);
+
+        static std::size_t memory(Table* table);
+        static void escape(std::ostream& stream, std::string const& name);
+
+        std::vector<Node> _nodes;
+        std::vector<Edge> _edges;
+        // Tables and functions, by address.
+        std::unordered_map<void const*, std::size_t> _ids;
+        // Strings, by buffer, offset and size: slices and prefixes of the
+        // same buffer are different strings.
+        std::map<std::tuple<void const*, std::size_t, std::size_t>, std::size_t> _strings;
+        std::vector<std::pair<Table*, std::size_t>> _tables;
+        std::vector<std::pair<Function*, std::size_t>> _functions;
+    };
+}
@@ -0,0 +1,239 @@
+#include <functional>
+#include <limits>
+#include <unordered_set>
+
+#include "interned_string.h"
+#include "memory.h"
+
+namespace Types {
+
+struct String::StorageHash {
+    typedef void is_transparent;
+
+    std::size_t operator()(std::string_view string) const {
+        return std::hash<std::string_view>()(string);
+    }
+
+    std::size_t operator()(Storage const* storage) const {
+        return storage->_hash;
+    }
+};
+
+struct String::StorageEqual {
+    typedef void is_transparent;
+
+    bool operator()(Storage const* left, Storage const* right) const {
+        return left == right;
+    }
+
+    bool operator()(std::string_view left, Storage const* right) const {
+        return left == right->_data;
+    }
+
+    bool operator()(Storage const* left, std::string_view right) const {
+        return left->_data == right;
+    }
+};
+
+struct String::Table : public std::unordered_set<Storage*, StorageHash, StorageEqual> {
+    // Storage of the empty string, which the table holds a reference to: it
+    // is never released, and moved-from Strings share it without allocating.
+    Storage* _empty;
+};
+
+// Never destroyed: static Values holding Strings may be released after it
+// otherwise.
+String::Table& String::table() {
+    static Table* strings = [] {
+        Table* table = new Table();
+        table->_empty = new Storage { std::string(), StorageHash()(std::string_view()), 1, 0, true, 0 };
+        table->insert(table->_empty);
+        return table;
+    }();
+    return *strings;
+}
+
+std::size_t String::footprint(std::string const& data) {
+    return sizeof(Storage) + data.capacity();
+}
+
+String::Storage* String::intern(std::string_view string) {
+    Table& strings = table();
+    auto iter = strings.find(string);
+    if (iter != strings.end()) {
+        ++(*iter)->_references;
+        return *iter;
+    }
+
+    std::string data(string);
+    Memory::charge(Memory::Kind::STRING, footprint(data));
+    Storage* storage = new Storage { std::move(data), StorageHash()(string), 1, 0, true, Memory::Account::current_id() };
+    strings.insert(storage);
+    return storage;
+}
+
+String::Storage* String::intern(std::string&& string) {
+    Table& strings = table();
+    auto iter = strings.find(std::string_view(string));
+    if (iter != strings.end()) {
+        ++(*iter)->_references;
+        return *iter;
+    }
+
+    std::size_t hash = StorageHash()(std::string_view(string));
+    Memory::charge(Memory::Kind::STRING, footprint(string));
+    Storage* storage = new Storage { std::move(string), hash, 1, 0, true, Memory::Account::current_id() };
+    strings.insert(storage);
+    return storage;
+}
+
+String::String() : String(std::string_view()) { }
+
+String::String(std::string&& string) : _storage(nullptr), _size(string.size()), _offset(0), _slice(false) {
+    _storage = intern(std::move(string));
+}
+
+String::String(std::string_view string) : _storage(intern(string)), _size(string.size()), _offset(0), _slice(false) { }
+
+String::String(String const& other) {
+    other.acquire();
+    _storage = other._storage;
+    _size = other._size;
+    _offset = other._offset;
+    _slice = other._slice;
+}
+
+// Steals the reference of other, without the compaction of slices done by
+// copies, which may allocate.
+String::String(String&& other) noexcept : _storage(other._storage), _size(other._size), _offset(other._offset), _slice(other._slice) {
+    other.clear();
+}
+
+String::~String() {
+    release();
+}
+
+String& String::operator=(String const& other) {
+    other.acquire();
+    release();
+    _storage = other._storage;
+    _size = other._size;
+    _offset = other._offset;
+    _slice = other._slice;
+    return *this;
+}
+
+String& String::operator=(String&& other) noexcept {
+    if (this != &other) {
+        release();
+        _storage = other._storage;
+        _size = other._size;
+        _offset = other._offset;
+        _slice = other._slice;
+        other.clear();
+    }
+    return *this;
+}
+
+String String::concat(String const& left, std::string_view right) {
+    std::size_t size = left.size() + right.size();
+    if (size < BuilderThreshold) {
+        std::string result;
+        result.reserve(size);
+        result.append(left.view()).append(right);
+        return String(result);
+    }
+
+    // right may be a view on the buffer of left (s .. s), that growing the
+    // buffer frees: copy it first.
+    std::string copy;
+    char const* begin = left._storage->_data.data();
+    if (right.data() >= begin && right.data() < begin + left._storage->_data.size()) {
+        copy = right;
+        right = copy;
+    }
+
+    Storage* builder = left._storage;
+    if (builder->_interned || left._slice || builder->_data.size() != left._size) {
+        // left does not end a buffer (anymore): start a new one.
+        std::string data;
+        data.reserve(size * 2);
+        data.append(left.view());
+        Memory::charge(Memory::Kind::STRING, footprint(data));
+        builder = new Storage { std::move(data), 0, 0, 0, false, Memory::Account::current_id() };
+    } else if (builder->_data.capacity() < size) {
+        std::size_t capacity = builder->_data.capacity();
+        Memory::charge(builder->_account, Memory::Kind::STRING, size * 2 - capacity, 0);
+        builder->_data.reserve(size * 2);
+    }
+
+    builder->_data.append(right);
+
+    ++builder->_references;
+    return String(builder, size);
+}
+
+String String::sub(std::size_t offset, std::size_t size) const {
+    if (offset == 0 && size == _size) {
+        return *this;
+    } else if (size < SliceThreshold || _offset + offset > std::numeric_limits<std::uint32_t>::max()) {
+        return String(view().substr(offset, size));
+    }
+
+    String slice(_storage, size);
+    ++_storage->_references;
+    ++_storage->_slices;
+    slice._offset = _offset + offset;
+    slice._slice = true;
+    return slice;
+}
+
+void String::materialize() const {
+    Storage* interned = intern(view());
+    release();
+    _storage = interned;
+    _offset = 0;
+    _slice = false;
+}
+
+void String::acquire() const {
+    if (_slice && _storage->_references == _storage->_slices && _size * CompactionRatio < _storage->_data.size()) {
+        // Only slices keep the storage alive, and this one only uses a small
+        // part of it: move it to its own storage before sharing it.
+        materialize();
+    }
+
+    ++_storage->_references;
+    if (_slice) {
+        ++_storage->_slices;
+    }
+}
+
+void String::clear() noexcept {
+    // The table exists: other Strings do.
+    _storage = table()._empty;
+    ++_storage->_references;
+    _size = 0;
+    _offset = 0;
+    _slice = false;
+}
+
+void String::release() const {
+    if (_slice) {
+        --_storage->_slices;
+    }
+
+    if (--_storage->_references == 0) {
+        if (_storage->_interned) {
+            table().erase(_storage);
+        }
+        Memory::credit(_storage->_account, Memory::Kind::STRING, footprint(_storage->_data));
+        delete _storage;
+    }
+}
+
+std::size_t String::count() {
+    return table().size();
+}
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "memory.h"
+
+namespace Types {
+    /* Immutable Lua string. All the strings with the same content share the
+     * same refcounted storage, that also holds the hash of the characters, so
+     * copying a String is a pointer copy, comparing two Strings for equality
+     * is a pointer comparison and hashing one is a load.
+     *
+     * Long strings produced by concatenation are not interned right away.
+     * They live in an append-only buffer, and a String only sees the prefix
+     * of the buffer it was created with. Appending to the String that ends
+     * the buffer extends the buffer in place, so building a string piece by
+     * piece (s = s .. piece) is amortized linear instead of quadratic. Such
+     * a String is interned the first time it is compared or hashed.
+     *
+     * Long substrings are slices: they share the storage of the string they
+     * were taken from, so taking one is O(1), and are interned the same way
+     * as builder strings. A slice that is much shorter than its storage is
+     * compacted into its own storage when it is copied while only slices
+     * keep the storage alive, so that a few words taken out of a large
+     * input do not keep all of it in memory.
+     *
+     * The intern table is not synchronized: Strings must be created and
+     * released from the thread running the interpreter.
+     */
+    class String {
+    public:
+        String();
+        String(std::string_view string);
+        String(std::string const& string) : String(std::string_view(string)) { }
+        // Takes the characters of string if they are not interned yet.
+        String(std::string&& string);
+        String(char const* string) : String(std::string_view(string)) { }
+
+        String(String const& other);
+        String(String&& other) noexcept;
+
+        ~String();
+
+        String& operator=(String const& other);
+        String& operator=(String&& other) noexcept;
+
+        bool operator==(String const& other) const { return storage() == other.storage(); }
+        bool operator!=(String const& other) const { return storage() != other.storage(); }
+
+        // Lexicographic order, as in Lua.
+        bool operator<(String const& other) const { return view() < other.view(); }
+        bool operator<=(String const& other) const { return view() <= other.view(); }
+        bool operator>(String const& other) const { return view() > other.view(); }
+        bool operator>=(String const& other) const { return view() >= other.view(); }
+
+        std::string const& str() const { return storage()->_data; }
+        // Only valid until the next concatenation.
+        std::string_view view() const { return std::string_view(_storage->_data.data() + _offset, _size); }
+        char const* data() const { return _storage->_data.data() + _offset; }
+        std::size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        std::size_t hash() const { return storage()->_hash; }
+
+        // Whether the characters are interned yet.
+        bool interned() const { return _storage->_interned && !_slice; }
+
+        // Whether the String shares the storage of a longer string.
+        bool slice() const { return _slice; }
+
+        // Storage the characters are read from, without interning them: the
+        // copies of a String, and the slices and prefixes of the same
+        // buffer, share it at their own offset.
+        void const* buffer() const { return _storage; }
+        std::size_t offset() const { return _offset; }
+
+        /* size characters starting at offset, which must be within the
+         * string. Short substrings are interned immediately; longer ones are
+         * slices of this string.
+         */
+        String sub(std::size_t offset, std::size_t size) const;
+
+        /* left .. right. Short results are interned immediately; longer ones
+         * extend the buffer of left if left ends it, or start a new buffer.
+         */
+        static String concat(String const& left, std::string_view right);
+
+        struct Hash {
+            std::size_t operator()(String const& string) const { return string.hash(); }
+        };
+
+        // Number of distinct strings currently interned.
+        static std::size_t count();
+
+    private:
+        struct Storage {
+            std::string _data;
+            std::size_t _hash;
+            unsigned int _references;
+            // Number of the references held by slices.
+            unsigned int _slices;
+            bool _interned;
+            // Charged for the characters, 0 for the empty string.
+            Memory::AccountId _account;
+        };
+
+        struct StorageHash;
+        struct StorageEqual;
+        struct Table;
+
+        // Concatenations shorter than this are interned immediately.
+        static constexpr std::size_t BuilderThreshold = 64;
+
+        // Substrings shorter than this are interned immediately.
+        static constexpr std::size_t SliceThreshold = 32;
+
+        // Slices are compacted when their storage is this many times larger
+        // than they are.
+        static constexpr std::size_t CompactionRatio = 4;
+
+        static Table& table();
+
+        // Bytes charged to the memory account for a storage of data.
+        static std::size_t footprint(std::string const& data);
+
+        static Storage* intern(std::string_view string);
+        static Storage* intern(std::string&& string);
+
+        String(Storage* storage, std::size_t size) : _storage(storage), _size(size), _offset(0), _slice(false) { }
+
+        Storage* storage() const {
+            if (!interned()) {
+                materialize();
+            }
+
+            return _storage;
+        }
+
+        void materialize() const;
+
+        // Add a reference to the storage, on behalf of a copy of this String.
+        void acquire() const;
+
+        void release() const;
+
+        // Point to the storage of the empty string, without releasing the
+        // current one: for moved-from Strings.
+        void clear() noexcept;
+
+        mutable Storage* _storage;
+        mutable std::size_t _size;
+        // Offsets of slices larger than 4 GB are not representable: such
+        // substrings are copied instead.
+        mutable std::uint32_t _offset;
+        mutable bool _slice;
+    };
+}
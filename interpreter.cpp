@@ -6,6 +6,7 @@
 #include <fstream>
 #include <iosfwd>
 #include <iterator>
+#include <optional>
 #include <ranges>
 #include <string>
 #include <sstream>
@@ -22,17 +23,33 @@
 #include "LuaParser.h"
 #include "LuaVisitor.h"
 
+#include "builtins.h"
+#include "collector.h"
+#include "conversions.h"
 #include "exceptions.h"
 #include "function_abstraction.h"
+#include "heap_snapshot.h"
 #include "interpreter.h"
+#include "operators.h"
 #include "syntactic_analyzer.h"
 #include "types.h"
 
-Interpreter::Interpreter(antlr4::tree::ParseTree* tree) {
+Interpreter::Interpreter() : _frame_upstream(_memory, Memory::Kind::FRAME), _frame_resource(&_frame_upstream) {
+    Memory::Account::Scope scope(_memory);
+    Builtins::register_builtins(*this);
+
+    Types::Collector::Stats collections = Types::Collector::instance().stats();
+    _freed_mark = collections._freed;
+    _swept_mark = collections._swept;
+    _slabs_mark = Types::allocation_stats();
+}
+
+Interpreter::Interpreter(antlr4::tree::ParseTree* tree) : Interpreter() {
     launch(tree);
 }
 
 Interpreter::~Interpreter() {
+    Memory::Account::Scope scope(_memory);
     for (auto& p: _global_values) {
         p.second->remove_reference();
     }
@@ -44,6 +61,14 @@ Interpreter::~Interpreter() {
             }
         }
     }
+
+    // Free the tables only this interpreter referenced, even if it was
+    // stopped.
+    Types::Collector& collector = Types::Collector::instance();
+    collector.request(true);
+    collector.collect();
+
+    Types::release_unused_memory();
 }
 
 void Interpreter::launch(antlr4::tree::ParseTree *tree) {
@@ -58,13 +83,128 @@ void Interpreter::register_global_c_function(const std::string &name, Types::Fun
     _global_values[name] = value;
 }
 
+void Interpreter::register_global(std::string const& name, Types::Value const& value) {
+    _global_values[name] = new Types::Value(value);
+}
+
+Types::VarList Interpreter::call(Types::Function* function, std::span<Types::Value const> arguments) {
+    Memory::Account::Scope scope(_memory);
+    if (_entries == 0) {
+        safe_point();
+    }
+
+    EntryCount entry(_entries);
+    return call_function(function, arguments);
+}
+
+void Interpreter::safe_point() {
+    Types::Collector& collector = Types::Collector::instance();
+    if (_collecting && collector.pending()) {
+        collector.collect();
+    }
+}
+
+Interpreter::CallFrame::CallFrame(Interpreter& interpreter, Types::Function* function) : _interpreter(interpreter), _function(function) {
+    _expression = single_expression(function);
+    if (!_expression) {
+        return;
+    }
+
+    // Same frame as call_function, with all the parameters bound to nil.
+    LuaParser::BlockContext* ctx = function->get_context();
+    _frames = _interpreter._local_values.size();
+    _depth = _interpreter._blocks.size();
+    _interpreter._local_values.emplace_back(&_interpreter._frame_resource);
+    _interpreter._functions.push_back(function);
+    _interpreter._blocks.push_back(ctx);
+    _interpreter.bind_parameters(function, std::span<Types::Value const>());
+
+    std::vector<std::string> const& parameters = function->formal_parameters();
+    for (size_t i = 0; i < parameters.size() && i < 2; ++i) {
+        _parameters[i] = _interpreter._local_values.back()[ctx][parameters[i]];
+    }
+}
+
+Interpreter::CallFrame::~CallFrame() {
+    if (!_expression) {
+        return;
+    }
+
+    // A failed comparison may have left the frames of the functions it
+    // called on the stack.
+    _interpreter._local_values.resize(_frames + 1, std::pmr::map<LuaParser::BlockContext*, ValueStore>(&_interpreter._frame_resource));
+    _interpreter.unwind_blocks(_depth);
+    _interpreter._functions.pop_back();
+    _interpreter._local_values.pop_back();
+}
+
+bool Interpreter::CallFrame::test(Types::Value const& left, Types::Value const& right) {
+    if (!_expression) {
+        Types::Value arguments[2] = { left, right };
+        Types::VarList results = _interpreter.call_function(_function, arguments);
+        return !results.empty() && results[0].as_bool_weak();
+    }
+
+    Types::Value const* values[2] = { &left, &right };
+    for (size_t i = 0; i < 2; ++i) {
+        if (Types::Value* parameter = _parameters[i]) {
+            sGC->add_reference(values[i]->value());
+            sGC->remove_reference(parameter->value());
+            parameter->value() = values[i]->value();
+        }
+    }
+
+    return _interpreter.process_condition(_expression);
+}
+
+/* The expression of a function of the form function(a, b) return exp end.
+ * A function defined in the expression could capture the parameters, that
+ * must then be fresh on each call: such expressions are not accepted.
+ */
+LuaParser::ExpContext* Interpreter::CallFrame::single_expression(Types::Function* function) {
+    if (!function->is_pure()) {
+        return nullptr;
+    }
+
+    std::vector<std::string> const& parameters = function->formal_parameters();
+    if (!parameters.empty() && parameters.back() == "...") {
+        return nullptr;
+    }
+
+    LuaParser::BlockContext* body = function->get_context();
+    LuaParser::RetstatContext* retstat = body->retstat();
+    if (!body->stat().empty() || !retstat || !retstat->explist() || retstat->explist()->exp().size() != 1) {
+        return nullptr;
+    }
+
+    std::vector<antlr4::tree::ParseTree*> pending { retstat->explist()->exp(0) };
+    while (!pending.empty()) {
+        antlr4::tree::ParseTree* tree = pending.back();
+        pending.pop_back();
+        if (dynamic_cast<LuaParser::FunctiondefContext*>(tree)) {
+            return nullptr;
+        }
+        pending.insert(pending.end(), tree->children.begin(), tree->children.end());
+    }
+
+    return retstat->explist()->exp(0);
+}
+
+void Interpreter::set_string_methods(Types::Value const& table) {
+    _string_methods = table;
+}
+
 antlrcpp::Any Interpreter::visitChunk(LuaParser::ChunkContext *context) {
     // std::cout << "Chunk: " << context->getText() << std::endl;
+    Memory::Account::Scope scope(_memory);
+    EntryCount entry(_entries);
     try {
-        _local_values.push_back(decltype(_local_values)::value_type());
+        _local_values.emplace_back(&_frame_resource);
         return visit(context->block());
     } catch (Exceptions::Return& ret) {
         return ret.get();
+    } catch (Exceptions::TailCall& call) {
+        return call_function(call.callee().as<Types::Function*>(), call.arguments());
     }
 }
 
@@ -87,6 +227,10 @@ antlrcpp::Any Interpreter::visitBlock(LuaParser::BlockContext *context) {
         try {
             visit(ctx);
             ++i;
+
+            if (_functions.empty()) {
+                safe_point();
+            }
         } catch (Exceptions::Goto& g) {
             stabilize_blocks(context);
 
@@ -184,11 +328,16 @@ antlrcpp::Any Interpreter::visitAttrib(LuaParser::AttribContext *) {
 }
 
 antlrcpp::Any Interpreter::visitRetstat(LuaParser::RetstatContext *context) {
-    std::vector<Types::Var> retval;
+    Types::VarList retval;
+    if (LuaParser::PrefixexpContext* call = tail_call(context)) {
+        process_tail_call(call); // [[noreturn]]
+    }
+
     if (LuaParser::ExplistContext* ctx = context->explist()) {
-        retval = visit(ctx).as<std::vector<Types::Var>>();
+        retval = visit(ctx).as<Types::VarList>();
+        expand_last(retval);
     } else {
-        std::vector<Types::Var> v;
+        Types::VarList v;
         v.push_back(Types::Var::make(Types::Value::make_nil()));
         retval = v;
     }
@@ -256,7 +405,7 @@ antlrcpp::Any Interpreter::visitFuncname(LuaParser::FuncnameContext *context) {
 
 antlrcpp::Any Interpreter::visitVarlist(LuaParser::VarlistContext *context) {
     _var__context = Var_Context::VARLIST;
-    std::vector<Types::Var> vars;
+    Types::VarList vars;
     for (LuaParser::Var_Context* ctx: context->var_()) {
         vars.push_back(visit(ctx).as<Types::Var>());
     }
@@ -275,7 +424,7 @@ antlrcpp::Any Interpreter::visitNamelist(LuaParser::NamelistContext *context) {
 }
 
 antlrcpp::Any Interpreter::visitExplist(LuaParser::ExplistContext *context) {
-    std::vector<Types::Var> values;
+    Types::VarList values;
     for (LuaParser::ExpContext* ctx: context->exp()) {
         values.push_back(visit(ctx).as<Types::Var>());
     }
@@ -284,6 +433,13 @@ antlrcpp::Any Interpreter::visitExplist(LuaParser::ExplistContext *context) {
 }
 
 antlrcpp::Any Interpreter::visitExp(LuaParser::ExpContext *context) {
+    // Binary operator sites already seen skip the expression kind detection.
+    if (auto site = _binary_sites.find(context); site != _binary_sites.end()) {
+        return Types::Var::make(process_binary(context, site->second));
+    } else if (auto site = _concat_sites.find(context); site != _concat_sites.end()) {
+        return Types::Var::make(process_concat(site->second));
+    }
+
     if (context->getText() == "nil") {
         return Types::Var::make(Types::Value::make_nil());
     } else if (context->getText() == "true") {
@@ -291,7 +447,7 @@ antlrcpp::Any Interpreter::visitExp(LuaParser::ExpContext *context) {
     } else if (context->getText() == "false") {
         return Types::Var::make(Types::Value::make_false());
     } else if (context->getText() == "...") {
-        return Types::Var::make(_local_values.back()[current_block()]["..."]);
+        return Types::Var::make(varargs());
     } else if (LuaParser::NumberContext* ctx = context->number()) {
         return visit(ctx);
     } else if (LuaParser::StringContext* ctx = context->string()) {
@@ -302,24 +458,16 @@ antlrcpp::Any Interpreter::visitExp(LuaParser::ExpContext *context) {
         return visit(ctx);
     } else if (LuaParser::TableconstructorContext* ctx = context->tableconstructor()) {
         return visit(ctx);
-    } else if (context->operatorPower()) {
-        // Promote both operands (if int or string representing double) to
-        // double for exponentiation.
-        Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        double left = leftV.as_double_weak();
-
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-        double right = rightV.as_double_weak();
-
-        return Types::Var::make(Types::Value::make_double(std::pow(left, right)));
+    } else if (LuaParser::OperatorPowerContext* ctx = context->operatorPower()) {
+        return Types::Var::make(process_binary(context, visit(ctx).as<Operators::Binary>()));
     } else if (LuaParser::OperatorUnaryContext* ctx = context->operatorUnary()) {
         Types::Var v = visit(context->exp()[0]).as<Types::Var>();
         OperatorUnary op = visit(ctx).as<OperatorUnary>();
 
         switch (op) {
         case OperatorUnary::BANG:
-            if (v.is<std::string>()) {
-                return Types::Var::make(Types::Value::make_int(v.as<std::string>().size()));
+            if (v.is<Types::String>()) {
+                return Types::Var::make(Types::Value::make_int(v.as<Types::String>().size()));
             } else {
                 return Types::Var::make(Types::Value::make_int(v.as<Types::Table*>()->border()));
             }
@@ -353,204 +501,33 @@ antlrcpp::Any Interpreter::visitExp(LuaParser::ExpContext *context) {
             throw std::runtime_error("Invalid Unary operator");
         }
     } else if (LuaParser::OperatorMulDivModContext* ctx = context->operatorMulDivMod()) {
-        Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-
-        Types::Var result;
-
-        double left = leftV.as_double_weak();
-        double right = rightV.as_double_weak();
-
-        OperatorMulDivMod op = visit(ctx).as<OperatorMulDivMod>();
-        switch (op) {
-        case OperatorMulDivMod::MUL:
-            if (leftV.is<int>() && rightV.is<int>()) {
-                result = Types::Var::make(Types::Value::make_int(leftV.as<int>() * rightV.as<int>()));
-            } else {
-                result = Types::Var::make(Types::Value::make_double(left * right));
-            }
-            break;
-
-        case OperatorMulDivMod::DIV:
-            result = Types::Var::make(Types::Value::make_double(left / right));
-            break;
-
-        case OperatorMulDivMod::MOD:
-            if (leftV.is<int>() && rightV.is<int>()) {
-                result = Types::Var::make(Types::Value::make_int(leftV.as<int>() % rightV.as<int>()));
-            } else {
-                result = Types::Var::make(Types::Value::make_double(std::remainder(left, right)));
-            }
-            break;
-
-        case OperatorMulDivMod::QUOT:
-            if (leftV.is<int>() && rightV.is<int>()) {
-                result = Types::Var::make(Types::Value::make_int(std::floor(left / right)));
-            } else {
-                result = Types::Var::make(Types::Value::make_double(std::floor(left / right)));
-            }
-            break;
-
-        default:
-            throw std::runtime_error("Invalid MulDivMod operator");
-        }
-
-        return result;
+        return Types::Var::make(process_binary(context, visit(ctx).as<Operators::Binary>()));
     } else if (LuaParser::OperatorAddSubContext* ctx = context->operatorAddSub()) {
-        Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-
-        Types::Var result;
-
-        OperatorAddSub op = visit(ctx);
-        if (leftV.is<int>() && rightV.is<int>()) {
-            int left = leftV.as<int>();
-            int right = rightV.as<int>();
-
-            switch (op) {
-            case OperatorAddSub::ADD:
-                result = Types::Var::make(Types::Value::make_int(left + right));
-                break;
-
-            case OperatorAddSub::SUB:
-                result = Types::Var::make(Types::Value::make_int(left - right));
-                break;
-
-            default:
-                throw std::runtime_error("Invalid AddSub operator");
-            }
-        } else {
-            double left = leftV.as_double_weak();
-            double right = rightV.as_double_weak();
-
-            switch (op) {
-            case OperatorAddSub::ADD:
-                result = Types::Var::make(Types::Value::make_double(left + right));
-                break;
-
-            case OperatorAddSub::SUB:
-                result = Types::Var::make(Types::Value::make_double(left - right));
-                break;
-
-            default:
-                throw std::runtime_error("Invalid AddSub operator");
-            }
-        }
-
-        return result;
+        return Types::Var::make(process_binary(context, visit(ctx).as<Operators::Binary>()));
     } else if (context->operatorStrcat()) {
-        // Promote numbers to strings if necessary.
-        // Note that Lua allows two numbers to concatenate as a string.
-        Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-
-        std::string left = leftV.as_string();
-        std::string right = rightV.as_string();
-
-        return Types::Var::make(Types::Value::make_string(left + right));
+        std::vector<LuaParser::ExpContext*>& operands = _concat_sites[context];
+        collect_concat_operands(context, operands);
+        return Types::Var::make(process_concat(operands));
     } else if (LuaParser::OperatorComparisonContext* ctx = context->operatorComparison()) {
-        Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-
-        double left = leftV.as_double_weak();
-        double right = rightV.as_double_weak();
-
-        OperatorComparison op = visit(ctx).as<OperatorComparison>();
-        std::function<bool(double, double)> fn;
-
-        switch (op) {
-        case OperatorComparison::DIFF:
-            fn = [](double x, double y) { return x != y ;};
-            break;
-
-        case OperatorComparison::EQ:
-            fn = [](double x, double y) { return x == y ;};
-            break;
-
-        case OperatorComparison::GREATER_E:
-            fn = [](double x, double y) { return x >= y ;};
-            break;
-
-        case OperatorComparison::GREATER_S:
-            fn = [](double x, double y) { return x > y ;};
-            break;
-
-        case OperatorComparison::LOWER_E:
-            fn = [](double x, double y) { return x <= y ;};
-            break;
-
-        case OperatorComparison::LOWER_S:
-            fn = [](double x, double y) { return x < y ;};
-            break;
-
-        default:
-            throw std::runtime_error("Invalid Comparison operator");
-        }
-
-        return Types::Var::make(Types::Value::make_bool(fn(left, right)));
+        return Types::Var::make(process_binary(context, visit(ctx).as<Operators::Binary>()));
     } else if (context->operatorAnd()) {
+        // The right operand is only evaluated if the left one is true.
         Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        bool left = leftV.as_bool_weak();
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-        // bool right = rightV->as_bool_weak();
-
-        // Decrease a single reference counter here because the value is
-        // returned by reference.
-        if (left) {
-            return rightV;
-        } else {
+        if (!leftV.as_bool_weak()) {
             return leftV; // false and nil == false, nil and false == nil
         }
+
+        return visit(context->exp()[1]);
     } else if (context->operatorOr()) {
+        // The right operand is only evaluated if the left one is false.
         Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-
-        bool left = leftV.as_bool_weak();
-        // bool right = rightV.as_bool_weak();
-
-        if (left) {
+        if (leftV.as_bool_weak()) {
             return leftV;
-        } else {
-            return rightV; // false or nil == nil, nil or false == false
-        }
-    } else if (LuaParser::OperatorBitwiseContext* ctx = context->operatorBitwise()) {
-        // Promote exact floats / strings representing exact floats to int
-        // for bitwise operations.
-        Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
-        Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
-
-        int left = leftV.as_int_weak();
-        int right = rightV.as_int_weak();
-
-        Types::Var result;
-
-        OperatorBitwise op = visit(ctx).as<OperatorBitwise>();
-        switch (op) {
-        case OperatorBitwise::AND:
-            result = Types::Var::make(Types::Value::make_int(left & right));
-            break;
-
-        case OperatorBitwise::LSHIFT:
-            result = Types::Var::make(Types::Value::make_int(left << right));
-            break;
-
-        case OperatorBitwise::OR:
-            result = Types::Var::make(Types::Value::make_int(left | right));
-            break;
-
-        case OperatorBitwise::RSHIFT:
-            result = Types::Var::make(Types::Value::make_int(left >> right));
-            break;
-
-        case OperatorBitwise::XOR:
-            result = Types::Var::make(Types::Value::make_int(left ^ right));
-            break;
-
-        default:
-            throw std::runtime_error("Invalid Bitwise operator");
         }
 
-        return result;
+        return visit(context->exp()[1]); // false or nil == nil, nil or false == false
+    } else if (LuaParser::OperatorBitwiseContext* ctx = context->operatorBitwise()) {
+        return Types::Var::make(process_binary(context, visit(ctx).as<Operators::Binary>()));
     } else {
         throw std::runtime_error("Invalid expression");
     }
@@ -585,7 +562,15 @@ antlrcpp::Any Interpreter::visitVarOrExp(LuaParser::VarOrExpContext *context) {
     if (context->var_()) {
         result = visit(context->var_()).as<Types::Var>();
     } else if (context->exp()) {
+        // Parentheses keep only the first value of a call or of ...
         result = visit(context->exp()).as<Types::Var>();
+        if (result.list()) {
+            std::vector<Types::Value>& values = result._list();
+            result = Types::Var::make(values.empty() ? Types::Value::make_nil() : values.front());
+        } else if (result.is<Types::Elipsis>()) {
+            std::span<Types::Value const> values = result.as<Types::Elipsis>().values();
+            result = Types::Var::make(values.empty() ? Types::Value::make_nil() : values.front());
+        }
     }
 
     return result;
@@ -633,7 +618,7 @@ antlrcpp::Any Interpreter::visitVar_(LuaParser::Var_Context *context) {
             } else {
                 result = Types::Var::make(&field);
             }
-        } else if (std::string* str = std::get_if<std::string>(&suffix._suffix)) {
+        } else if (Types::String* str = std::get_if<Types::String>(&suffix._suffix)) {
             if (!result.is<Types::Table*>()) {
                 throw Exceptions::BadDotAccess(result.type_as_string());
             }
@@ -665,7 +650,7 @@ antlrcpp::Any Interpreter::visitVarSuffix(LuaParser::VarSuffixContext *context)
     }
 
     if (context->NAME()) {
-        result._suffix = context->NAME()->getText();
+        result._suffix = Types::String(context->NAME()->getText());
     } else {
         Subscript sub;
         sub._value = visit(context->exp()).as<Types::Var>();
@@ -677,7 +662,7 @@ antlrcpp::Any Interpreter::visitVarSuffix(LuaParser::VarSuffixContext *context)
 antlrcpp::Any Interpreter::visitNameAndArgs(LuaParser::NameAndArgsContext *context) {
     NameAndArgs res;
     if (context->NAME()) {
-        res._name = context->NAME()->getText();
+        res._name = Types::String(context->NAME()->getText());
     }
 
     res._args = visit(context->args()).as<Args>();
@@ -689,24 +674,14 @@ antlrcpp::Any Interpreter::visitArgs(LuaParser::ArgsContext *context) {
     Args args;
 
     if (context->explist()) {
-        args = visit(context->explist()).as<std::vector<Types::Var>>();
-        std::vector<Types::Var>& values = std::get<std::vector<Types::Var>>(args);
-
-        // Immediately expand the last argument if it is an elipsis or
-        // a list of values. This will help when processing arguments
-        // further down the road.
-        std::vector<Types::Value> remains;
-        if (values.size() != 0) {
-            Types::Var& last = values.back();
-            if (last.is<Types::Elipsis>()) {
-                remains = last.as<Types::Elipsis>().values();
-            } else if (last.list()) {
-                remains = last._list();
-            }
-        }
-
-        for (Types::Value const& value: remains) {
-            values.push_back(Types::Var::make(value));
+        args = visit(context->explist()).as<Types::VarList>();
+
+        // Immediately expand the last argument if it is a list of values.
+        // This will help when processing arguments further down the road.
+        // A trailing ... is kept whole, the callee shares its values.
+        Types::VarList& values = std::get<Types::VarList>(args);
+        if (!values.empty() && values.back().list()) {
+            expand_last(values);
         }
     } else if (context->tableconstructor()) {
         TableConstructor constructor;
@@ -717,7 +692,7 @@ antlrcpp::Any Interpreter::visitArgs(LuaParser::ArgsContext *context) {
         string._var = visit(context->string()).as<Types::Var>();
         args = string;
     } else {
-        args = std::vector<Types::Var>();
+        args = Types::VarList();
     }
 
     return args;
@@ -760,19 +735,34 @@ antlrcpp::Any Interpreter::visitParlist(LuaParser::ParlistContext *context) {
 }
 
 antlrcpp::Any Interpreter::visitTableconstructor(LuaParser::TableconstructorContext *context) {
-    std::list<std::pair<Types::Value, Types::Value>> values;
-
     if (LuaParser::FieldlistContext* ctx = context->fieldlist()) {
-        values = visit(ctx).as<std::list<std::pair<Types::Value, Types::Value>>>();
+        return visit(ctx);
     }
 
-    return Types::Var::make(Types::Value::make_table(values));
+    return Types::Var::make(Types::Value::make_table(0, 0));
 }
 
+/* The fields without a key and the ones with a name as key are counted
+ * first, so that the array and string parts of the table are allocated
+ * at their final size before the fields are added.
+ */
 antlrcpp::Any Interpreter::visitFieldlist(LuaParser::FieldlistContext *context) {
-    std::list<std::pair<Types::Value, Types::Value>> values;
+    std::vector<LuaParser::FieldContext*> fields(context->field());
+    std::size_t positional = 0;
+    std::size_t named = 0;
+    for (LuaParser::FieldContext* ctx: fields) {
+        if (ctx->NAME()) {
+            ++named;
+        } else if (ctx->exp().size() == 1) {
+            ++positional;
+        }
+    }
+
+    Types::Value table = Types::Value::make_table(positional, named);
+    Types::Table* t = table.as<Types::Table*>();
+
     unsigned int index = 1;
-    for (LuaParser::FieldContext* ctx: context->field()) {
+    for (LuaParser::FieldContext* ctx: fields) {
         std::pair<std::optional<Types::Var>, Types::Var> value = visit(ctx).as<std::pair<std::optional<Types::Var>, Types::Var>>();
         if (value.first && value.first->is<Types::Nil>()) {
             continue;
@@ -786,21 +776,19 @@ antlrcpp::Any Interpreter::visitFieldlist(LuaParser::FieldlistContext *context)
                 index++;
                 continue;
             }
-            Types::Value key = Types::Value::make_int(index++);
-            values.push_back(std::make_pair(key, value.second.get()));
+            t->add_field(Types::Value::make_int(index++), value.second.get());
+        } else if (ctx->NAME()) {
+            t->add_field(value.first->as<Types::String>(), value.second.get());
         } else {
-            values.push_back(std::make_pair(value.first->get(), value.second.get()));
+            t->add_field(value.first->get(), value.second.get());
         }
     }
 
-    return values;
+    return Types::Var::make(std::move(table));
 }
 
 antlrcpp::Any Interpreter::visitField(LuaParser::FieldContext *context) {
-    std::string text(context->getText());
-
-    if (text.starts_with("[")) {
-        // std::cout << "[NYI] Expressions as keys" << std::endl;
+    if (context->exp().size() == 2) {
         return std::make_pair(std::make_optional(visit(context->exp(0)).as<Types::Var>()), visit(context->exp(1)).as<Types::Var>());
     } else if (context->NAME()) {
         return std::make_pair(std::make_optional(Types::Var::make(Types::Value::make_string(context->NAME()->getText()))), visit(context->exp()[0]).as<Types::Var>());
@@ -825,35 +813,35 @@ antlrcpp::Any Interpreter::visitOperatorComparison(LuaParser::OperatorComparison
     std::string symbol(context->getText());
 
     if (symbol == "<") {
-        return OperatorComparison::LOWER_S;
+        return Operators::Binary::LOWER_S;
     } else if (symbol == ">") {
-        return OperatorComparison::GREATER_S;
+        return Operators::Binary::GREATER_S;
     } else if (symbol == "<=") {
-        return OperatorComparison::LOWER_E;
+        return Operators::Binary::LOWER_E;
     } else if (symbol == ">=") {
-        return OperatorComparison::GREATER_E;
+        return Operators::Binary::GREATER_E;
     } else if (symbol == "~=") {
-        return OperatorComparison::DIFF;
+        return Operators::Binary::DIFF;
     } else if (symbol == "==") {
-        return OperatorComparison::EQ;
+        return Operators::Binary::EQ;
     } else {
-        return OperatorComparison::ERROR;
+        return Operators::Binary::ERROR;
     }
 }
 
 antlrcpp::Any Interpreter::visitOperatorStrcat(LuaParser::OperatorStrcatContext *) {
-    return nullptr;
+    return Operators::Binary::STRCAT;
 }
 
 antlrcpp::Any Interpreter::visitOperatorAddSub(LuaParser::OperatorAddSubContext *context) {
     std::string symbol(context->getText());
 
     if (symbol == "+") {
-        return OperatorAddSub::ADD;
+        return Operators::Binary::ADD;
     } else if (symbol == "-") {
-        return OperatorAddSub::SUB;
+        return Operators::Binary::SUB;
     } else {
-        return OperatorAddSub::ERROR;
+        return Operators::Binary::ERROR;
     }
 }
 
@@ -861,15 +849,15 @@ antlrcpp::Any Interpreter::visitOperatorMulDivMod(LuaParser::OperatorMulDivModCo
     std::string symbol(context->getText());
 
     if (symbol == "*") {
-        return OperatorMulDivMod::MUL;
+        return Operators::Binary::MUL;
     } else if (symbol == "/") {
-        return OperatorMulDivMod::DIV;
+        return Operators::Binary::DIV;
     } else if (symbol == "%") {
-        return OperatorMulDivMod::MOD;
+        return Operators::Binary::MOD;
     } else if (symbol == "//") {
-        return OperatorMulDivMod::QUOT;
+        return Operators::Binary::QUOT;
     } else {
-        return OperatorMulDivMod::ERROR;
+        return Operators::Binary::ERROR;
     }
 }
 
@@ -877,17 +865,17 @@ antlrcpp::Any Interpreter::visitOperatorBitwise(LuaParser::OperatorBitwiseContex
     std::string symbol(context->getText());
 
     if (symbol == "&") {
-        return OperatorBitwise::AND;
+        return Operators::Binary::AND;
     } else if (symbol == "|") {
-        return OperatorBitwise::OR;
+        return Operators::Binary::OR;
     } else if (symbol == "~") {
-        return OperatorBitwise::XOR;
+        return Operators::Binary::XOR;
     } else if (symbol == "<<") {
-        return OperatorBitwise::LSHIFT;
+        return Operators::Binary::LSHIFT;
     } else if (symbol == ">>") {
-        return OperatorBitwise::RSHIFT;
+        return Operators::Binary::RSHIFT;
     } else {
-        return OperatorBitwise::ERROR;
+        return Operators::Binary::ERROR;
     }
 }
 
@@ -908,22 +896,32 @@ antlrcpp::Any Interpreter::visitOperatorUnary(LuaParser::OperatorUnaryContext *c
 }
 
 antlrcpp::Any Interpreter::visitOperatorPower(LuaParser::OperatorPowerContext *) {
-    return nullptr;
+    return Operators::Binary::POWER;
 }
 
 antlrcpp::Any Interpreter::visitNumber(LuaParser::NumberContext *context) {
-    if (auto ptr = context->INT()) {
-        return Types::Var::make(Types::Value::make_int(std::stoi(ptr->getText())));
-    } else if (auto ptr = context->HEX()) {
-        return Types::Var::make(Types::Value::make_int(std::stoi(ptr->getText(), nullptr, 16)));
-    } else if (auto ptr = context->FLOAT()) {
-        return Types::Var::make(Types::Value::make_double(std::stod(ptr->getText())));
-    } else if (auto ptr = context->HEX_FLOAT()) {
-        std::cout << "[NYI] Hexfloat" << std::endl;
-        return Types::Var::make(Types::Value::make_double(std::stod(ptr->getText())));
-    } else {
+    antlr4::tree::TerminalNode* ptr = context->INT();
+    if (!ptr) {
+        ptr = context->HEX();
+    }
+
+    if (ptr) {
+        // Integer literals too large for an int are read as doubles.
+        std::string text(ptr->getText());
+        if (std::optional<int> i = Conversions::to_int(text)) {
+            return Types::Var::make(Types::Value::make_int(*i));
+        }
+    } else if (!(ptr = context->FLOAT())) {
+        ptr = context->HEX_FLOAT();
+    }
+
+    // Literals out of the range of doubles are read as inf or 0.
+    std::optional<double> d = ptr ? Conversions::to_double(ptr->getText()) : std::nullopt;
+    if (!d) {
         throw std::runtime_error("Invalid number");
     }
+
+    return Types::Var::make(Types::Value::make_double(*d));
 }
 
 antlrcpp::Any Interpreter::visitString(LuaParser::StringContext *context) {
@@ -941,10 +939,16 @@ antlrcpp::Any Interpreter::visitString(LuaParser::StringContext *context) {
     }
 }
 
-Interpreter::ArgsVisitor::ArgsVisitor(std::vector<Types::Value>& dest) : _dest(dest) { }
+Interpreter::ArgsVisitor::ArgsVisitor(std::vector<Types::Value>& dest, Types::Elipsis& rest) : _dest(dest), _rest(rest) { }
 
-void Interpreter::ArgsVisitor::operator()(std::vector<Types::Var> const& args) {
-    std::transform(args.begin(), args.end(), std::back_inserter(_dest), [](Types::Var const& var) { return var.get(); });
+void Interpreter::ArgsVisitor::operator()(Types::VarList const& args) {
+    size_t n = args.size();
+    if (n != 0 && args.back().is<Types::Elipsis>()) {
+        _rest = args.back().as<Types::Elipsis>();
+        --n;
+    }
+
+    std::transform(args.begin(), args.begin() + n, std::back_inserter(_dest), [](Types::Var const& var) { return var.get(); });
 }
 
 void Interpreter::ArgsVisitor::operator()(TableConstructor const& cons) {
@@ -956,8 +960,8 @@ void Interpreter::ArgsVisitor::operator()(String const& string) {
 }
 
 void Interpreter::process_stat_var_list(LuaParser::VarlistContext* varlist, LuaParser::ExplistContext* explist) {
-    std::vector<Types::Var> vars = visit(varlist).as<std::vector<Types::Var>>();
-    std::vector<Types::Var> exprs = visit(explist).as<std::vector<Types::Var>>();
+    Types::VarList vars = visit(varlist).as<Types::VarList>();
+    Types::VarList exprs = visit(explist).as<Types::VarList>();
 
     for (Types::Var& v: std::views::filter(exprs, [](Types::Var const& v) { return v.lvalue(); })) {
         v.morph();
@@ -986,7 +990,8 @@ void Interpreter::process_stat_var_list(LuaParser::VarlistContext* varlist, LuaP
                     j = 0;
                     --i; // Rewrite the last value because it actually holds
                          // the whole Elipsis, instead of its first value.
-                    remains = last.as<Types::Elipsis>().values();
+                    std::span<Types::Value const> values = last.as<Types::Elipsis>().values();
+                    remains.assign(values.begin(), values.end());
                 } else {
                     j = 1;
                     remains = std::move(last._list());
@@ -1021,7 +1026,7 @@ void Interpreter::process_goto(std::string const& label) {
 void Interpreter::process_while(LuaParser::ExpContext* exp, LuaParser::BlockContext* block) {
     LuaParser::BlockContext* current = current_block();
     try {
-        while (visit(exp).as<Types::Var>().as_bool_weak()) {
+        while (process_condition(exp)) {
             visit(block);
         }
     } catch (Exceptions::Break& brk) {
@@ -1034,7 +1039,7 @@ void Interpreter::process_repeat(LuaParser::BlockContext* block, LuaParser::ExpC
     try {
         do {
             visit(block);
-        } while (!visit(exp).as<Types::Var>().as_bool_weak());
+        } while (!process_condition(exp));
     } catch (Exceptions::Break& brk) {
         stabilize_blocks(current);
     }
@@ -1045,7 +1050,7 @@ void Interpreter::process_if(LuaParser::StatContext* ctx) {
 
     bool found = false;
     for (unsigned int i = 0; i < conditions.size(); ++i) {
-        if (visit(conditions[i]).as<Types::Var>().as_bool_weak()) {
+        if (process_condition(conditions[i])) {
             visit(ctx->block()[i]);
             found = true;
             break;
@@ -1062,7 +1067,7 @@ void Interpreter::process_if(LuaParser::StatContext* ctx) {
 
 void Interpreter::process_for_in(LuaParser::NamelistContext* nl, LuaParser::ExplistContext* el, LuaParser::BlockContext* block) {
     std::vector<std::string> names = visit(nl).as<std::vector<std::string>>();
-    std::vector<Types::Var> exprs = visit(el).as<std::vector<Types::Var>>();
+    Types::VarList exprs = visit(el).as<Types::VarList>();
 
     /* for var1, ..., varn in exprlist do
      *   stmts
@@ -1097,8 +1102,10 @@ void Interpreter::process_for_in(LuaParser::NamelistContext* nl, LuaParser::Expl
         std::vector<Types::Value> const& values = exprs.back()._list();
         std::ranges::for_each(values, [&loop_values](Types::Value const& value) { loop_values.push_back(value);});
     } else if (exprs.back().is<Types::Elipsis>()) {
-        std::vector<Types::Value> const& values = exprs.back().as<Types::Elipsis>().values();
+        std::span<Types::Value const> values = exprs.back().as<Types::Elipsis>().values();
         std::ranges::for_each(values, [&loop_values](Types::Value const& value) { loop_values.push_back(value);});
+    } else {
+        loop_values.push_back(exprs.back().get());
     }
 
     if (loop_values.size() < 1) {
@@ -1125,7 +1132,7 @@ void Interpreter::process_for_in(LuaParser::NamelistContext* nl, LuaParser::Expl
 
     try {
         while (true) {
-            std::vector<Types::Var> results = call_function(loop_values.front().as<Types::Function*>(), std::vector<Types::Value>{state, iteration_value});
+            Types::VarList results = call_function(loop_values.front().as<Types::Function*>(), Types::ValueList{state, iteration_value});
             if (results.size() == 0 || results[0].is<Types::Nil>()) {
                 throw Exceptions::Break();
             }
@@ -1141,12 +1148,13 @@ void Interpreter::process_for_in(LuaParser::NamelistContext* nl, LuaParser::Expl
             if (results.size() < names.size()) {
                 unsigned int i;
                 if (results.back().is<Types::Elipsis>()) {
-                    std::vector<Types::Value> const& remains = results.back().as<Types::Elipsis>().values();
+                    std::span<Types::Value const> remains = results.back().as<Types::Elipsis>().values();
                     i = results.size() - 1;
                     for (unsigned int j = 0 ; j < remains.size() && i < names.size(); ++i, ++j) {
                         if (i < results.size()) {
                             sGC->remove_reference(_local_values.back()[block][names[i]]->value());
-                            *(_local_values.back()[block][names[i]]) = remains[j];
+                            _local_values.back()[block][names[i]]->value() = remains[j].value();
+                            sGC->add_reference(remains[j].value());
                         } else {
                             Types::Value* value = new Types::Value;
                             *value = remains[j];
@@ -1272,10 +1280,10 @@ void Interpreter::process_function(LuaParser::FuncnameContext* name, LuaParser::
 
 void Interpreter::process_local_variables(LuaParser::AttnamelistContext* al, LuaParser::ExplistContext* el) {
     std::vector<std::string> names = visit(al).as<std::vector<std::string>>();
-    std::vector<Types::Var> values;
+    Types::VarList values;
 
     if (el) {
-         values = visit(el).as<std::vector<Types::Var>>();
+         values = visit(el).as<Types::VarList>();
     } else {
         values.resize(names.size(), Types::Var::make(Types::Value::make_nil()));
     }
@@ -1301,7 +1309,8 @@ void Interpreter::process_local_variables(LuaParser::AttnamelistContext* al, Lua
 
             if (last.is<Types::Elipsis>() || last.list()) {
                 if (last.is<Types::Elipsis>()) {
-                    remains = last.as<Types::Elipsis>().values();
+                    std::span<Types::Value const> values = last.as<Types::Elipsis>().values();
+                    remains.assign(values.begin(), values.end());
                     j = 0;
                     --i;
                 } else {
@@ -1425,6 +1434,17 @@ void Interpreter::stabilize_blocks(LuaParser::BlockContext* context) {
     }
 }
 
+// Erase all blocks above the first depth ones. Unlike stabilize_blocks, this
+// does not rely on block identity, which is ambiguous when a function calls
+// itself.
+void Interpreter::unwind_blocks(size_t depth) {
+    for (size_t i = depth; i < _blocks.size(); ++i) {
+        erase_block(_blocks[i]);
+    }
+
+    _blocks.resize(depth);
+}
+
 void Interpreter::erase_block(LuaParser::BlockContext* context) {
     clear_block(context);
     _local_values.back().erase(context);
@@ -1447,65 +1467,155 @@ void Interpreter::close_function(Types::Function* function, LuaParser::BlockCont
     }
 }
 
-std::vector<Types::Var> Interpreter::call_function(Types::Function* function, std::vector<Types::Value> const& values) {
+void Interpreter::bind_parameters(Types::Function* function, std::span<Types::Value const> values, Types::Elipsis const& rest) {
+    LuaParser::BlockContext* ctx = function->get_context();
+    std::vector<std::string> const& parameters = function->formal_parameters();
+
+    bool vararg = !parameters.empty() && parameters.back() == "...";
+    size_t n_named = parameters.size() - (vararg ? 1 : 0);
+
+    // Adjust if necessary. If not enough arguments provided, fill with nil.
+    // If too many arguments, send the rest as an elipsis if the function
+    // has an elipsis as parameter; otherwise discard the rest.
+    std::span<Types::Value const> extra = rest.values();
+    for (size_t i = 0; i < n_named; ++i) {
+        Types::Value* value = new Types::Value();
+        Types::Value const* argument = nullptr;
+        if (i < values.size()) {
+            argument = &values[i];
+        } else if (i - values.size() < extra.size()) {
+            argument = &extra[i - values.size()];
+        }
+
+        if (argument) {
+            value->value() = argument->value();
+            sGC->add_reference(argument->value());
+        }
+        _local_values.back()[ctx][parameters[i]] = value;
+    }
+
+    if (vararg) {
+        Types::Value* elipsis = new Types::Value();
+        if (values.size() <= n_named) {
+            // Everything after the named parameters comes from rest: share
+            // it, this is what makes f(...) O(1) in the number of values.
+            elipsis->value() = Types::Elipsis(rest, n_named - values.size());
+        } else if (extra.empty()) {
+            elipsis->value() = Types::Elipsis(values.subspan(n_named));
+        } else {
+            std::vector<Types::Value> combined(values.begin() + n_named, values.end());
+            combined.insert(combined.end(), extra.begin(), extra.end());
+            elipsis->value() = Types::Elipsis(std::move(combined));
+        }
+        _local_values.back()[ctx]["..."] = elipsis;
+    }
+}
+
+Types::VarList Interpreter::call_function(Types::Function* function, std::span<Types::Value const> values, Types::Elipsis const& rest) {
+    bool takes_rest = function->is_native() && function->native_vararg();
+    if (!function->is_pure() && rest.size() != 0 && !takes_rest) {
+        // Other native functions see all their arguments in a single span.
+        std::span<Types::Value const> extra = rest.values();
+        Types::ValueList arguments;
+        arguments.reserve(values.size() + extra.size());
+        arguments.assign(values.begin(), values.end());
+        for (Types::Value const& value: extra) {
+            arguments.push_back(value);
+        }
+        return call_function(function, arguments);
+    }
+
     if (function->is_c()) {
         return call_c_function(function, values);
+    } else if (function->is_native()) {
+        // Natives get their own copy of the arguments: values is a window
+        // into the value stack, that moves when a native calls back into the
+        // interpreter and the stack grows.
+        Types::Value const* state = function->native_state();
+        Types::ValueList arguments;
+        arguments.reserve(values.size() + (state ? 1 : 0));
+        if (state) {
+            arguments.push_back(*state);
+        }
+        for (Types::Value const& value: values) {
+            arguments.push_back(value);
+        }
+        if (rest.size() != 0) {
+            return function->native_vararg()(*this, arguments, rest);
+        }
+        return function->native()(*this, arguments);
     }
 
-    LuaParser::BlockContext* ctx = function->get_context();
-    LuaParser::BlockContext* current_block = this->current_block();
+    size_t depth = _blocks.size();
 
-    _blocks.push_back(ctx);
-    _local_values.push_back(decltype(_local_values)::value_type());
+    _local_values.emplace_back(&_frame_resource);
     /* for (auto& p: function->closure()) {
         _local_values.back()[p.first] = p.second;
     } */
     _functions.push_back(function);
 
-    unsigned int i = 0;
-    for (; i < std::min(values.size(), function->formal_parameters().size()); ++i) {
-        Types::Value* value = new Types::Value();
-        value->value() = values[i].value();
-        sGC->add_reference(values[i].value());
-        _local_values.back()[ctx][function->formal_parameters()[i]] = value;
-    }
+    // Callee and arguments of the tail calls performed from this frame.
+    Types::Value callee;
+    Types::ValueList tail_arguments;
+    std::span<Types::Value const> arguments = values;
+    Types::Elipsis trailing = rest;
 
-    // Adjust if necessary. If not enough arguments provided, fill with nil.
-    // If too many arguments, send the rest as an elipsis if the function
-    // has an elipsis as parameter; otherwise discard the rest.
-    if (i < function->formal_parameters().size()) {
-        for (; i < function->formal_parameters().size(); ++i) {
-            _local_values.back()[ctx][function->formal_parameters()[i]] = new Types::Value();
-        }
-    } else if (i < values.size()) {
-        if (function->formal_parameters().back() == "...") {
-            Types::Value* elipsis = new Types::Value();
-            std::vector<Types::Value> elipsis_values;
-            for (; i < values.size(); ++i) {
-                elipsis_values.push_back(values[i]);
+    while (true) {
+        LuaParser::BlockContext* ctx = function->get_context();
+        _blocks.push_back(ctx);
+
+        try {
+            bind_parameters(function, arguments, trailing);
+            _coming_from_funcall = true;
+            visit(ctx);
+            _functions.pop_back();
+            _local_values.pop_back();
+            return Types::VarList();
+        } catch (Exceptions::Return& e) {
+            // If control flow is disrupted by a return statement, blocks may
+            // not be in a coherent state. Stabilize them only in this case.
+            unwind_blocks(depth);
+            _functions.pop_back();
+            _local_values.pop_back();
+            return e.get();
+        } catch (Exceptions::TailCall& call) {
+            // The arguments of the tail call have already been evaluated:
+            // release the current frame and reuse it for the callee.
+            unwind_blocks(depth);
+            while (!_local_values.back().empty()) {
+                erase_block(_local_values.back().begin()->first);
             }
-            elipsis->value() = Types::Elipsis(elipsis_values);
-            _local_values.back()[ctx]["..."] = elipsis;
-        }
-    }
 
-    _coming_from_funcall = true;
-    try {
-        visit(ctx);
-        _functions.pop_back();
-        _local_values.pop_back();
-        return std::vector<Types::Var>();
-    } catch (Exceptions::Return& e) {
-        // If control flow is disrupted by a return statement, blocks may
-        // not be in a coherent state. Stabilize them only in this case.
-        stabilize_blocks(current_block);
-        _functions.pop_back();
-        _local_values.pop_back();
-        return e.get();
+            // Reference the new callee before releasing the previous one,
+            // they may be the same function.
+            sGC->add_reference(call.callee().value());
+            sGC->remove_reference(callee.value());
+            callee.value() = call.callee().value();
+
+            tail_arguments = std::move(call.arguments());
+            arguments = tail_arguments;
+            trailing = call.rest();
+            function = callee.as<Types::Function*>();
+
+            if (!function->is_pure()) {
+                _functions.pop_back();
+                _local_values.pop_back();
+                return call_function(function, arguments, trailing);
+            }
+
+            _functions.back() = function;
+        } catch (...) {
+            // Errors unwind the frame, for pcall to resume in its own.
+            _coming_from_funcall = false;
+            unwind_blocks(depth);
+            _functions.pop_back();
+            _local_values.pop_back();
+            throw;
+        }
     }
 }
 
-std::vector<Types::Var> Interpreter::call_c_function(Types::Function *function, const std::vector<Types::Value> &values) {
+Types::VarList Interpreter::call_c_function(Types::Function *function, std::span<Types::Value const> values) {
     FunctionAbstractionBuilderAbstraction* builder = function->builder();
     FunctionAbstraction* abstraction = builder->build();
 
@@ -1515,7 +1625,7 @@ std::vector<Types::Var> Interpreter::call_c_function(Types::Function *function,
 
     abstraction->call();
 
-    return std::vector<Types::Var>();
+    return Types::VarList();
 }
 
 bool Interpreter::funcall_test_infrastructure(LuaParser::FunctioncallContext* context) {
@@ -1532,7 +1642,11 @@ bool Interpreter::funcall_test_infrastructure(LuaParser::FunctioncallContext* co
         "print",
         "globals",
         "locals",
-        "memory"
+        "memory",
+        "quickening",
+        "allocations",
+        "slabs",
+        "memory_limit"
     };
 
     if (!std::any_of(allowed_names.begin(), allowed_names.end(), [funcname](const std::string& str) {
@@ -1551,14 +1665,14 @@ bool Interpreter::funcall_test_infrastructure(LuaParser::FunctioncallContext* co
         if (!middle.is_refcounted() && left != middle) {
             throw Exceptions::ValueEqualityExpected(expression, middle.value_as_string(), left.value_as_string());
         }
-        std::string type(std::move(right.as<std::string>()));
+        std::string type(right.as<Types::String>().str());
         if (type != "int" && type != "double" && type != "string" && type != "table" && type != "bool" && type != "nil") {
             throw std::runtime_error("Invalid type in ensure_type " + type);
         }
 
         if ((type == "int" && !left.is<int>()) ||
             (type == "double" && !left.is<double>()) ||
-            (type == "string" && !left.is<std::string>()) ||
+            (type == "string" && !left.is<Types::String>()) ||
             (type == "table" && !left.is<Types::Table*>()) ||
             (type == "bool" && !left.is<bool>()) ||
             (type == "nil" && !left.is<Types::Nil>())) {
@@ -1607,6 +1721,78 @@ bool Interpreter::funcall_test_infrastructure(LuaParser::FunctioncallContext* co
                 }
             }
         }
+    } else if (funcname == "quickening") {
+        QuickeningStats stats = quickening_stats();
+        std::cout << "Binary operator sites: " << stats._sites << " (int: " << stats._int << ", double: " << stats._double << ", other: " << stats._other << ", generic: " << stats._generic << ")" << std::endl;
+
+        // quickening(sites, int, double, other, generic) checks the counts.
+        if (LuaParser::ExplistContext* explist = context->nameAndArgs()[0]->args()->explist()) {
+            const char* names[] = { "sites", "int", "double", "other", "generic" };
+            size_t counts[] = { stats._sites, stats._int, stats._double, stats._other, stats._generic };
+            for (size_t i = 0; i < explist->exp().size() && i < std::size(counts); ++i) {
+                Types::Var expected = visit(explist->exp()[i]).as<Types::Var>();
+                if (static_cast<size_t>(expected.as_int_weak()) != counts[i]) {
+                    throw Exceptions::ValueEqualityExpected(std::string("quickening ") + names[i], expected.value_as_string(), std::to_string(counts[i]));
+                }
+            }
+        }
+    } else if (funcname == "allocations") {
+        Types::AllocationStats stats = Types::allocation_stats();
+        auto print = [](const char* name, SlabStats const& slab) {
+            std::cout << name << ": " << slab._live << " live, " << slab._peak << " peak, " << slab._allocations << " allocated, " << slab._chunks << " chunks" << std::endl;
+        };
+        print("Values", stats._values);
+        print("Tables", stats._tables);
+        print("Functions", stats._functions);
+
+        Types::Collector::Stats collections = Types::Collector::instance().stats();
+        std::cout << "Collections: " << collections._minor << " minor, " << collections._major << " major, " << collections._freed << " tables freed, " << collections._swept << " by the sweeper (young: " << collections._young << ", old: " << collections._old << ")" << std::endl;
+
+        // allocations(freed, swept) checks that at least that many tables
+        // were freed, and deleted by the Sweeper, since the last call.
+        size_t freed = collections._freed - _freed_mark;
+        size_t swept = collections._swept - _swept_mark;
+        _freed_mark = collections._freed;
+        _swept_mark = collections._swept;
+        if (LuaParser::ExplistContext* explist = context->nameAndArgs()[0]->args()->explist()) {
+            const char* names[] = { "freed", "swept" };
+            size_t counts[] = { freed, swept };
+            for (size_t i = 0; i < explist->exp().size() && i < std::size(counts); ++i) {
+                Types::Var expected = visit(explist->exp()[i]).as<Types::Var>();
+                if (counts[i] < static_cast<size_t>(expected.as_int_weak())) {
+                    throw Exceptions::ValueEqualityExpected(std::string("allocations ") + names[i], "at least " + expected.value_as_string(), std::to_string(counts[i]));
+                }
+            }
+        }
+    } else if (funcname == "slabs") {
+        // slabs(live, chunks) checks that the Value, Table and Function slabs
+        // hold at most that many more objects and chunks than at the last
+        // call: released slots are reused before new chunks are added.
+        Types::AllocationStats stats = Types::allocation_stats();
+        Types::AllocationStats mark = _slabs_mark;
+        _slabs_mark = stats;
+        if (LuaParser::ExplistContext* explist = context->nameAndArgs()[0]->args()->explist()) {
+            std::pair<const char*, SlabStats Types::AllocationStats::*> slabs[] = {
+                { "Values", &Types::AllocationStats::_values },
+                { "Tables", &Types::AllocationStats::_tables },
+                { "Functions", &Types::AllocationStats::_functions }
+            };
+            const char* names[] = { "live", "chunks" };
+            size_t SlabStats::* counts[] = { &SlabStats::_live, &SlabStats::_chunks };
+            for (size_t i = 0; i < explist->exp().size() && i < std::size(counts); ++i) {
+                size_t allowed = visit(explist->exp()[i]).as<Types::Var>().as_int_weak();
+                for (auto const& [slab, member]: slabs) {
+                    size_t before = mark.*member.*counts[i];
+                    size_t after = stats.*member.*counts[i];
+                    if (after > before + allowed) {
+                        throw Exceptions::ValueEqualityExpected(std::string("slabs ") + slab + " " + names[i], "at most " + std::to_string(before + allowed), std::to_string(after));
+                    }
+                }
+            }
+        }
+    } else if (funcname == "memory_limit") {
+        Types::Var limit = visit(context->nameAndArgs()[0]->args()->explist()->exp()[0]).as<Types::Var>();
+        set_memory_limit(limit.as_int_weak());
     } else {
         return false;
     }
@@ -1614,39 +1800,225 @@ bool Interpreter::funcall_test_infrastructure(LuaParser::FunctioncallContext* co
     return true;
 }
 
-Types::Var Interpreter::process_names_and_args(Types::Var const& src, std::vector<NameAndArgs> const& names_and_args) {
-    Types::Var result = src;
-    for (NameAndArgs const& name_and_args: names_and_args) {
-        Types::Function* function;
-        if (name_and_args._name) {
-            if (!result.is<Types::Table*>()) {
-                throw Exceptions::BadDotAccess(result.type_as_string());
-            }
+void Interpreter::set_memory_limit(size_t bytes) {
+    _memory.set_limit(bytes);
+}
+
+Memory::Stats const& Interpreter::memory_stats() const {
+    return _memory.stats();
+}
+
+void Interpreter::write_heap_snapshot(std::ostream& stream) {
+    Types::HeapSnapshot snapshot;
+
+    std::size_t globals = snapshot.add_group("(globals)");
+    for (auto const& [name, value]: _global_values) {
+        snapshot.add_root(globals, name, value->value());
+    }
 
-            Types::Value& fn = result.as<Types::Table*>()->dot(*name_and_args._name);
-            if (!fn.is<Types::Function*>()) {
-                throw Exceptions::BadCall(fn.type_as_string());
+    for (size_t depth = 0; depth < _local_values.size(); ++depth) {
+        std::size_t frame = snapshot.add_group("(frame " + std::to_string(depth) + ")");
+        for (ValueStore const& locals: std::views::values(_local_values[depth])) {
+            for (auto const& [name, value]: locals) {
+                snapshot.add_root(frame, name, value->value());
             }
+        }
+    }
 
-            function = fn.as<Types::Function*>();
-        } else {
-            if (!result.is<Types::Function*>()) {
-                throw Exceptions::BadCall(result.type_as_string());
+    std::size_t calls = snapshot.add_group("(calls)");
+    for (size_t depth = 0; depth < _functions.size(); ++depth) {
+        snapshot.add_root(calls, "[" + std::to_string(depth) + "]", Types::LuaValue(_functions[depth]));
+    }
+
+    std::size_t stack = snapshot.add_group("(stack)");
+    for (size_t i = 0; i < _value_stack.size(); ++i) {
+        snapshot.add_root(stack, "[" + std::to_string(i) + "]", _value_stack[i].value());
+    }
+
+    std::size_t string_methods = snapshot.add_group("(string methods)");
+    snapshot.add_root(string_methods, "string", _string_methods.value());
+
+    snapshot.write(stream);
+}
+
+Interpreter::QuickeningStats Interpreter::quickening_stats() const {
+    const std::size_t int_tag = Types::LuaValue(0).index();
+    const std::size_t double_tag = Types::LuaValue(0.0).index();
+
+    QuickeningStats stats;
+    stats._sites = _binary_sites.size();
+    for (auto const& [_, site]: _binary_sites) {
+        if (site._state == SiteState::GENERIC) {
+            ++stats._generic;
+        } else if (site._state == SiteState::SPECIALIZED) {
+            if (site._left == int_tag && site._right == int_tag) {
+                ++stats._int;
+            } else if (site._left == double_tag && site._right == double_tag) {
+                ++stats._double;
+            } else {
+                ++stats._other;
             }
+        }
+    }
 
-            function = result.as<Types::Function*>();
+    return stats;
+}
+
+void Interpreter::expand_last(Types::VarList& values) {
+    if (values.empty()) {
+        return;
+    }
+
+    Types::ValueList expanded;
+    Types::Var& last = values.back();
+    if (last.list()) {
+        std::vector<Types::Value>& list = last._list();
+        expanded.assign(std::make_move_iterator(list.begin()), std::make_move_iterator(list.end()));
+    } else if (last.is<Types::Elipsis>()) {
+        std::span<Types::Value const> elipsis = last.as<Types::Elipsis>().values();
+        expanded.assign(elipsis.begin(), elipsis.end());
+    } else {
+        return;
+    }
+
+    values.pop_back();
+    for (Types::Value& value: expanded) {
+        values.push_back(Types::Var::make(std::move(value)));
+    }
+}
+
+Types::Value Interpreter::varargs() {
+    Types::Value result;
+    if (Types::Function* function = current_function()) {
+        auto const& store = _local_values.back()[function->get_context()];
+        auto it = store.find("...");
+        if (it != store.end()) {
+            result = *it->second;
+        }
+    }
+
+    if (!result.is<Types::Elipsis>()) {
+        result.value() = Types::Elipsis();
+    }
+
+    return result;
+}
+
+Types::Value Interpreter::process_binary(LuaParser::ExpContext* context, Operators::Binary op) {
+    BinarySite& site = _binary_sites[context];
+    site._operator = op;
+    return process_binary(context, site);
+}
+
+Types::Value Interpreter::process_binary(LuaParser::ExpContext* context, BinarySite& site) {
+    Types::Var leftV = visit(context->exp()[0]).as<Types::Var>();
+    Types::Var rightV = visit(context->exp()[1]).as<Types::Var>();
+
+    Types::Value const& left = leftV.peek();
+    Types::Value const& right = rightV.peek();
+    std::size_t left_tag = left.value().index();
+    std::size_t right_tag = right.value().index();
+
+    switch (site._state) {
+    case SiteState::SPECIALIZED:
+        if (left_tag == site._left && right_tag == site._right) {
+            return site._kernel(left, right);
         }
+        site._state = SiteState::GENERIC;
+        break;
+
+    case SiteState::UNSPECIALIZED:
+        site._state = SiteState::SPECIALIZED;
+        site._left = left_tag;
+        site._right = right_tag;
+        site._kernel = Operators::kernel(site._operator, left_tag, right_tag);
+        return site._kernel(left, right);
+
+    default:
+        break;
+    }
+
+    return Operators::kernel(site._operator, left_tag, right_tag)(left, right);
+}
+
+void Interpreter::collect_concat_operands(LuaParser::ExpContext* context, std::vector<LuaParser::ExpContext*>& operands) {
+    if (context->operatorStrcat()) {
+        collect_concat_operands(context->exp()[0], operands);
+        collect_concat_operands(context->exp()[1], operands);
+    } else {
+        operands.push_back(context);
+    }
+}
+
+Types::Value Interpreter::process_concat(std::vector<LuaParser::ExpContext*> const& operands) {
+    Types::ValueList values;
+    size_t size = 0;
+    for (LuaParser::ExpContext* operand: operands) {
+        values.push_back(visit(operand).as<Types::Var>().get());
+        if (values.back().is<Types::String>()) {
+            size += values.back().as<Types::String>().size();
+        }
+    }
+
+    // Everything after the first operand is joined in a single allocation,
+    // then appended to the first operand, which may extend its buffer in
+    // place.
+    bool leading_string = values.front().is<Types::String>();
+    std::string tail;
+    tail.reserve(size);
+    for (size_t i = leading_string ? 1 : 0; i < values.size(); ++i) {
+        if (values[i].is<Types::String>()) {
+            tail.append(values[i].as<Types::String>().view());
+        } else {
+            tail.append(values[i].as_string());
+        }
+    }
+
+    if (leading_string) {
+        return Types::Value::make_string(Types::String::concat(values.front().as<Types::String>(), tail));
+    }
+
+    return Types::Value::make_string(tail);
+}
+
+bool Interpreter::process_condition(LuaParser::ExpContext* context) {
+    if (auto site = _binary_sites.find(context); site != _binary_sites.end()) {
+        return process_binary(context, site->second).as_bool_weak();
+    }
 
-        std::vector<Types::Value> arguments;
-        // Push the table as argument if using the ':' notation.
-        if (name_and_args._name) {
-            arguments.push_back(result.get());
+    if (context->operatorAnd()) {
+        return process_condition(context->exp()[0]) && process_condition(context->exp()[1]);
+    } else if (context->operatorOr()) {
+        return process_condition(context->exp()[0]) || process_condition(context->exp()[1]);
+    } else if (LuaParser::OperatorUnaryContext* ctx = context->operatorUnary()) {
+        if (visit(ctx).as<OperatorUnary>() == OperatorUnary::NOT) {
+            return !process_condition(context->exp()[0]);
         }
-        std::visit(ArgsVisitor(arguments), name_and_args._args);
+    } else if (LuaParser::PrefixexpContext* ctx = context->prefixexp()) {
+        // Parenthesized condition
+        if (ctx->nameAndArgs().empty() && ctx->varOrExp()->exp()) {
+            return process_condition(ctx->varOrExp()->exp());
+        }
+    }
 
-        std::vector<Types::Var> results = call_function(function, arguments);
+    return visit(context).as<Types::Var>().as_bool_weak();
+}
+
+Types::Var Interpreter::process_names_and_args(Types::Var const& src, std::vector<NameAndArgs> const& names_and_args) {
+    Types::Var result = src;
+    for (NameAndArgs const& name_and_args: names_and_args) {
+        StackWindow window(_value_stack);
+        Types::Elipsis rest;
+        Types::Function* function = prepare_call(result, name_and_args, _value_stack, rest);
+
+        Types::VarList results = call_function(function, window.values(), rest);
         if (results.size() == 0) {
             result = Types::Var::make(Types::Value::make_nil());
+        } else if (results.size() == 1 && results.front().is<Types::Elipsis>()) {
+            // Tail selected by select: kept whole, as ... is.
+            result = results.front();
+        } else if (results.size() == 1) {
+            result = Types::Var::make(results.front().get());
         } else {
             std::vector<Types::Value> tmp;
             std::transform(results.begin(), results.end(), std::back_inserter(tmp), [](Types::Var const& v) { return v.get(); });
@@ -1656,3 +2028,74 @@ Types::Var Interpreter::process_names_and_args(Types::Var const& src, std::vecto
 
     return result;
 }
+
+Types::Function* Interpreter::prepare_call(Types::Var const& src, NameAndArgs const& name_and_args, std::vector<Types::Value>& arguments, Types::Elipsis& rest) {
+    Types::Function* function;
+    if (name_and_args._name) {
+        Types::Table* table;
+        if (src.is<Types::Table*>()) {
+            table = src.as<Types::Table*>();
+        } else if (src.is<Types::String>() && _string_methods.is<Types::Table*>()) {
+            table = _string_methods.as<Types::Table*>();
+        } else {
+            throw Exceptions::BadDotAccess(src.type_as_string());
+        }
+
+        Types::Value& fn = table->dot(*name_and_args._name);
+        if (!fn.is<Types::Function*>()) {
+            throw Exceptions::BadCall(fn.type_as_string());
+        }
+
+        function = fn.as<Types::Function*>();
+    } else {
+        if (!src.is<Types::Function*>()) {
+            throw Exceptions::BadCall(src.type_as_string());
+        }
+
+        function = src.as<Types::Function*>();
+    }
+
+    // Push the table as argument if using the ':' notation.
+    if (name_and_args._name) {
+        arguments.push_back(src.get());
+    }
+    std::visit(ArgsVisitor(arguments, rest), name_and_args._args);
+
+    return function;
+}
+
+// A return statement is a tail call if its only expression is a function
+// call. A parenthesized call is not a tail call, as it truncates the results
+// of the call to a single value.
+LuaParser::PrefixexpContext* Interpreter::tail_call(LuaParser::RetstatContext* context) {
+    LuaParser::ExplistContext* explist = context->explist();
+    if (!explist || explist->exp().size() != 1) {
+        return nullptr;
+    }
+
+    LuaParser::PrefixexpContext* prefixexp = explist->exp(0)->prefixexp();
+    if (!prefixexp || prefixexp->nameAndArgs().empty()) {
+        return nullptr;
+    }
+
+    return prefixexp;
+}
+
+void Interpreter::process_tail_call(LuaParser::PrefixexpContext* context) {
+    Types::Var source = visit(context->varOrExp()).as<Types::Var>();
+    std::vector<NameAndArgs> names_and_args;
+    for (LuaParser::NameAndArgsContext* ctx: context->nameAndArgs()) {
+        names_and_args.push_back(visit(ctx).as<NameAndArgs>());
+    }
+
+    // Perform all the calls of the chain but the last one.
+    NameAndArgs last = names_and_args.back();
+    names_and_args.pop_back();
+    source = process_names_and_args(source, names_and_args);
+
+    StackWindow window(_value_stack);
+    Types::Elipsis rest;
+    Types::Function* function = prepare_call(source, last, _value_stack, rest);
+    std::span<Types::Value const> values = window.values();
+    throw Exceptions::TailCall(function, Types::ValueList(values.begin(), values.end()), rest);
+}
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <map>
+#include <memory_resource>
+#include <ostream>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -10,12 +14,14 @@
 #include "LuaParser.h"
 #include "LuaVisitor.h"
 
+#include "memory.h"
+#include "operators.h"
 #include "syntactic_analyzer.h"
 #include "types.h"
 
 class Interpreter : public LuaVisitor {
 public:
-    Interpreter() { }
+    Interpreter();
     Interpreter(antlr4::tree::ParseTree* tree);
 
     ~Interpreter();
@@ -98,40 +104,81 @@ public:
 
     void register_global_c_function(std::string const& name, Types::Function* function);
 
-private:
-    enum class OperatorComparison {
-        LOWER_S,
-        GREATER_S,
-        LOWER_E,
-        GREATER_E,
-        DIFF,
-        EQ,
-        ERROR
-    };
+    void register_global(std::string const& name, Types::Value const& value);
 
-    enum class OperatorAddSub {
-        ADD,
-        SUB,
-        ERROR
-    };
+    // Call a function from native code.
+    Types::VarList call(Types::Function* function, std::span<Types::Value const> arguments);
 
-    enum class OperatorMulDivMod {
-        MUL,
-        DIV,
-        MOD,
-        QUOT,
-        ERROR
+    /* Function called many times in a row from native code with two
+     * arguments, such as the comparison of table.sort. If the function is
+     * a Lua function whose body is a single return of one expression, its
+     * frame is set up once, and each call only rebinds the parameters and
+     * evaluates the expression. Any other function goes through call().
+     */
+    class CallFrame {
+    public:
+        CallFrame(Interpreter& interpreter, Types::Function* function);
+        ~CallFrame();
+
+        CallFrame(CallFrame const&) = delete;
+        CallFrame& operator=(CallFrame const&) = delete;
+
+        // Truth value of the first result of function(left, right).
+        bool test(Types::Value const& left, Types::Value const& right);
+
+    private:
+        static LuaParser::ExpContext* single_expression(Types::Function* function);
+
+        Interpreter& _interpreter;
+        Types::Function* _function;
+
+        // Null if the function is called through call().
+        LuaParser::ExpContext* _expression = nullptr;
+        Types::Value* _parameters[2] = { nullptr, nullptr };
+        size_t _frames = 0;
+        size_t _depth = 0;
     };
 
-    enum class OperatorBitwise {
-        AND,
-        OR,
-        XOR,
-        LSHIFT,
-        RSHIFT,
-        ERROR
+    // Table in which the methods called on strings (s:sub(1, 2)) are looked
+    // up, as if it were the __index of the metatable of strings.
+    void set_string_methods(Types::Value const& table);
+
+    struct QuickeningStats {
+        size_t _sites = 0; // Binary operator sites evaluated at least once
+        size_t _int = 0; // Sites specialized on int operands
+        size_t _double = 0; // Sites specialized on double operands
+        size_t _other = 0; // Sites specialized on any other pair of types
+        size_t _generic = 0; // Sites that saw a guard failure
     };
 
+    QuickeningStats quickening_stats() const;
+
+    // Bytes the values, tables, functions, strings and frames created by the
+    // interpreter may use, 0 (the default) for no limit. Allocations over
+    // it raise Exceptions::MemoryLimit, which pcall catches.
+    void set_memory_limit(size_t bytes);
+
+    Memory::Stats const& memory_stats() const;
+
+    /* collectgarbage("stop") and "restart". A stopped interpreter runs no
+     * collection at its safe points. The collector is shared: other
+     * interpreters still collect, the tables of this one included, and the
+     * interpreter always collects when it is destroyed.
+     */
+    void set_collecting(bool collecting) { _collecting = collecting; }
+    bool collecting() const { return _collecting; }
+
+    /* Write a snapshot of the objects reachable from the globals, the locals
+     * of the frames in progress, the functions being called and the value
+     * stack, in the format of Types::HeapSnapshot.
+     */
+    void write_heap_snapshot(std::ostream& stream);
+
+private:
+    // Charged for the memory used by the interpreter. Declared first, to be
+    // destroyed after the members that release memory.
+    Memory::Account _memory;
+
     enum class OperatorUnary {
         NOT,
         BANG,
@@ -153,6 +200,31 @@ private:
 
     Var_Context _var__context = Var_Context::OTHER;
 
+    // Binary operator sites start unspecialized. The first evaluation
+    // records the type tags of both operands and caches the kernel for
+    // them, guarded by a check on the tags. A guard failure sends the site
+    // to the generic path (one lookup in the kernel table) for good, so
+    // polymorphic sites do not flip back and forth.
+    enum class SiteState {
+        UNSPECIALIZED,
+        SPECIALIZED,
+        GENERIC
+    };
+
+    struct BinarySite {
+        Operators::Binary _operator;
+        SiteState _state = SiteState::UNSPECIALIZED;
+        std::size_t _left = 0;
+        std::size_t _right = 0;
+        Operators::Kernel _kernel = nullptr;
+    };
+
+    std::unordered_map<LuaParser::ExpContext*, BinarySite> _binary_sites;
+
+    // Operands of the concatenation chains (a .. b .. c) already seen,
+    // indexed by the root of the chain.
+    std::unordered_map<LuaParser::ExpContext*, std::vector<LuaParser::ExpContext*>> _concat_sites;
+
     struct TableConstructor {
         Types::Var _var;
     };
@@ -162,22 +234,25 @@ private:
     };
 
 
-    typedef std::variant<std::vector<Types::Var>, TableConstructor, String> Args;
+    typedef std::variant<Types::VarList, TableConstructor, String> Args;
 
+    // Push the arguments to dest, except a trailing ... that is stored in
+    // rest, to be passed on without copying its values.
     class ArgsVisitor {
     public:
-        ArgsVisitor(std::vector<Types::Value>& dest);
+        ArgsVisitor(std::vector<Types::Value>& dest, Types::Elipsis& rest);
 
-        void operator()(std::vector<Types::Var> const& args);
+        void operator()(Types::VarList const& args);
         void operator()(TableConstructor const& cons);
         void operator()(String const& string);
 
     private:
         std::vector<Types::Value>& _dest;
+        Types::Elipsis& _rest;
     };
 
     struct NameAndArgs {
-        std::optional<std::string> _name = std::nullopt;
+        std::optional<Types::String> _name = std::nullopt;
         Args _args;
     };
 
@@ -185,7 +260,7 @@ private:
         Types::Var _value;
     };
 
-    typedef std::variant<Subscript, std::string, Types::VarError> Suffix;
+    typedef std::variant<Subscript, Types::String, Types::VarError> Suffix;
 
     struct VarSuffix {
         std::vector<NameAndArgs> _name_and_args;
@@ -221,6 +296,27 @@ private:
 
     Types::Var nyi(std::string const& str);
 
+    // Expand the last expression of a list if it yields several values
+    // (function call, ...).
+    void expand_last(Types::VarList& values);
+
+    // Extra arguments of the running function, empty if it has none.
+    Types::Value varargs();
+
+    Types::Value process_binary(LuaParser::ExpContext* context, Operators::Binary op);
+
+    Types::Value process_binary(LuaParser::ExpContext* context, BinarySite& site);
+
+    void collect_concat_operands(LuaParser::ExpContext* context, std::vector<LuaParser::ExpContext*>& operands);
+
+    // A whole concatenation chain, evaluated left to right and built in a
+    // single allocation.
+    Types::Value process_concat(std::vector<LuaParser::ExpContext*> const& operands);
+
+    // Truth value of an expression used as a condition. and / or / not are
+    // lowered to plain control flow instead of building intermediate values.
+    bool process_condition(LuaParser::ExpContext* context);
+
     std::pair<Types::Value*, Scope> lookup_name(std::string const& name, bool should_throw = true);
 
     LuaParser::BlockContext* current_block();
@@ -229,27 +325,74 @@ private:
 
     void stabilize_blocks(LuaParser::BlockContext* context);
 
+    void unwind_blocks(size_t depth);
+
+    /* Run the collection of tables that is due, if any. Called between the
+     * statements of the main chunk, and by calls from the host: when no
+     * expression is being evaluated, that could hold pointers into tables
+     * without references.
+     */
+    void safe_point();
+
     void erase_block(LuaParser::BlockContext* context);
 
     void clear_block(LuaParser::BlockContext* context);
 
     void close_function(Types::Function* function, LuaParser::BlockContext* body);
 
-    std::vector<Types::Var> call_function(Types::Function* function, std::vector<Types::Value> const& values);
+    // The arguments are values followed by the values of rest. The extra
+    // arguments of a vararg function share the storage of rest when they
+    // all come from it.
+    void bind_parameters(Types::Function* function, std::span<Types::Value const> values, Types::Elipsis const& rest = Types::Elipsis());
+
+    Types::VarList call_function(Types::Function* function, std::span<Types::Value const> values, Types::Elipsis const& rest = Types::Elipsis());
 
-    std::vector<Types::Var> call_c_function(Types::Function* function, std::vector<Types::Value> const& values);
+    Types::VarList call_c_function(Types::Function* function, std::span<Types::Value const> values);
 
     bool funcall_test_infrastructure(LuaParser::FunctioncallContext* context);
 
     Types::Var process_names_and_args(Types::Var const& src, std::vector<NameAndArgs> const& names_and_args);
 
-    typedef std::map<std::string, Types::Value*> ValueStore;
+    Types::Function* prepare_call(Types::Var const& src, NameAndArgs const& name_and_args, std::vector<Types::Value>& arguments, Types::Elipsis& rest);
+
+    LuaParser::PrefixexpContext* tail_call(LuaParser::RetstatContext* context);
+
+    [[noreturn]] void process_tail_call(LuaParser::PrefixexpContext* context);
+
+    typedef std::pmr::map<std::string, Types::Value*> ValueStore;
+
+    // Arguments of a call are pushed in a window at the top of the value
+    // stack, and popped when the call returns or throws. The window is only
+    // valid until the callee starts running: parameters are bound before
+    // anything else is evaluated, and nested calls may grow the stack.
+    class StackWindow {
+    public:
+        StackWindow(std::vector<Types::Value>& stack) : _stack(stack), _base(stack.size()) { }
+        ~StackWindow() { _stack.erase(_stack.begin() + _base, _stack.end()); }
+
+        std::span<Types::Value const> values() const {
+            return std::span<Types::Value const>(_stack.data() + _base, _stack.size() - _base);
+        }
+
+    private:
+        std::vector<Types::Value>& _stack;
+        size_t _base;
+    };
+
+    std::vector<Types::Value> _value_stack;
+
+    Types::Value _string_methods;
+
+    // Memory of the frames is recycled from one call to the next instead of
+    // going through the global allocator. Must outlive _local_values.
+    Memory::AccountedResource _frame_upstream;
+    std::pmr::unsynchronized_pool_resource _frame_resource;
 
     // Scope processing works like a stack. Each time a new scope is
     // entered, push a new map on top of the stack to store the local
     // Values of the scope. Once the scope is exited, pop this map from
     // the stack.
-    std::vector<std::map<LuaParser::BlockContext*, ValueStore>> _local_values;
+    std::vector<std::pmr::map<LuaParser::BlockContext*, ValueStore>> _local_values;
     ValueStore _global_values;
 
     SyntacticAnalyzer _listener;
@@ -258,4 +401,31 @@ private:
     std::vector<Types::Function*> _functions;
     bool _coming_from_for = false;
     bool _coming_from_funcall = false;
+
+    // Counts the runs of the main chunk and the calls from native code in
+    // progress.
+    class EntryCount {
+    public:
+        EntryCount(size_t& count) : _count(count) { ++_count; }
+        ~EntryCount() { --_count; }
+
+        EntryCount(EntryCount const&) = delete;
+        EntryCount& operator=(EntryCount const&) = delete;
+
+    private:
+        size_t& _count;
+    };
+
+    size_t _entries = 0;
+
+    // Whether safe points run the collections that are due.
+    bool _collecting = true;
+
+    // Tables freed by the collections, and deleted by the Sweeper, when the
+    // interpreter started or the allocations test builtin last ran.
+    size_t _freed_mark = 0;
+    size_t _swept_mark = 0;
+
+    // Slabs when the interpreter started or the slabs test builtin last ran.
+    Types::AllocationStats _slabs_mark;
 };
@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+#include "exceptions.h"
+#include "lua_pattern.h"
+#include "string_search.h"
+
+namespace Patterns {
+
+namespace {
+
+// Same limit on the nesting of the matcher as the reference implementation.
+constexpr unsigned int MaxDepth = 200;
+
+// Programs are kept until the cache is full, at which point it is emptied.
+// Scripts use a handful of patterns, usually literals.
+constexpr std::size_t MaxCachedPrograms = 256;
+
+unsigned char byte(char c) {
+    return static_cast<unsigned char>(c);
+}
+
+// Set of the characters of the class %c. Upper case classes are the
+// complement of their lower case counterpart. Returns false if c is not a
+// class, in which case %c is the character c itself.
+bool add_class(char c, std::bitset<256>& set) {
+    int (*predicate)(int) = nullptr;
+    switch (std::tolower(byte(c))) {
+    case 'a': predicate = &isalpha; break;
+    case 'c': predicate = &iscntrl; break;
+    case 'd': predicate = &isdigit; break;
+    case 'g': predicate = &isgraph; break;
+    case 'l': predicate = &islower; break;
+    case 'p': predicate = &ispunct; break;
+    case 's': predicate = &isspace; break;
+    case 'u': predicate = &isupper; break;
+    case 'w': predicate = &isalnum; break;
+    case 'x': predicate = &isxdigit; break;
+    default: return false;
+    }
+
+    bool complement = std::isupper(byte(c));
+    for (int i = 0; i < 256; ++i) {
+        if ((predicate(i) != 0) != complement) {
+            set.set(i);
+        }
+    }
+
+    return true;
+}
+
+}
+
+/* Backtracking matcher, the counterpart of do_match in lstrlib.c. Single
+ * character items without quantifier are matched in a loop, recursion only
+ * happens where the matcher may have to come back: quantifiers and
+ * captures.
+ */
+class Program::Matcher {
+public:
+    Matcher(Program const& program, std::string_view subject, Match& match) : _program(program), _subject(subject), _match(match) { }
+
+    bool match(std::size_t i, std::size_t s) {
+        if (++_depth > MaxDepth) {
+            throw Exceptions::MalformedPattern(_program._pattern, "pattern too complex");
+        }
+
+        bool matched = match_items(i, s);
+        --_depth;
+        return matched;
+    }
+
+    std::size_t end() const { return _end; }
+
+private:
+    bool match_items(std::size_t i, std::size_t s) {
+        std::vector<Item> const& items = _program._items;
+        while (i < items.size()) {
+            Item const& item = items[i];
+            switch (item._kind) {
+            case Kind::OPEN: {
+                Capture& capture = _match._captures[item._capture];
+                capture = { s, Capture::Unfinished };
+                if (match(i + 1, s)) {
+                    return true;
+                }
+                capture._length = Capture::Unfinished;
+                return false;
+            }
+
+            case Kind::CLOSE: {
+                Capture& capture = _match._captures[item._capture];
+                capture._length = static_cast<long>(s - capture._start);
+                if (match(i + 1, s)) {
+                    return true;
+                }
+                capture._length = Capture::Unfinished;
+                return false;
+            }
+
+            case Kind::POSITION:
+                _match._captures[item._capture] = { s, Capture::Position };
+                ++i;
+                break;
+
+            case Kind::END:
+                if (s != _subject.size()) {
+                    return false;
+                }
+                ++i;
+                break;
+
+            case Kind::BALANCE:
+                s = balance(item, s);
+                if (s == std::string_view::npos) {
+                    return false;
+                }
+                ++i;
+                break;
+
+            case Kind::FRONTIER: {
+                char previous = s == 0 ? '\0' : _subject[s - 1];
+                char current = s < _subject.size() ? _subject[s] : '\0';
+                if (item._set[byte(previous)] || !item._set[byte(current)]) {
+                    return false;
+                }
+                ++i;
+                break;
+            }
+
+            case Kind::BACKREFERENCE: {
+                Capture const& capture = _match._captures[item._capture];
+                if (capture._length < 0) {
+                    return false;
+                }
+
+                std::size_t length = capture._length;
+                if (_subject.size() - s < length || _subject.substr(s, length) != _subject.substr(capture._start, length)) {
+                    return false;
+                }
+                s += length;
+                ++i;
+                break;
+            }
+
+            case Kind::SINGLE: {
+                bool matches = single(item, s);
+                switch (item._quantifier) {
+                case '?':
+                    if (matches && match(i + 1, s + 1)) {
+                        return true;
+                    }
+                    ++i;
+                    break;
+
+                case '+':
+                    return matches && max_expand(i, s + 1);
+
+                case '*':
+                    return max_expand(i, s);
+
+                case '-':
+                    return min_expand(i, s);
+
+                default:
+                    if (!matches) {
+                        return false;
+                    }
+                    ++s;
+                    ++i;
+                    break;
+                }
+                break;
+            }
+            }
+        }
+
+        _end = s;
+        return true;
+    }
+
+    bool single(Item const& item, std::size_t s) const {
+        return s < _subject.size() && item._set[byte(_subject[s])];
+    }
+
+    // Longest repetition of the item first, shortest last.
+    bool max_expand(std::size_t i, std::size_t s) {
+        Item const& item = _program._items[i];
+        std::size_t count = 0;
+        while (single(item, s + count)) {
+            ++count;
+        }
+
+        for (;;) {
+            if (match(i + 1, s + count)) {
+                return true;
+            } else if (count == 0) {
+                return false;
+            }
+            --count;
+        }
+    }
+
+    bool min_expand(std::size_t i, std::size_t s) {
+        Item const& item = _program._items[i];
+        for (;;) {
+            if (match(i + 1, s)) {
+                return true;
+            } else if (single(item, s)) {
+                ++s;
+            } else {
+                return false;
+            }
+        }
+    }
+
+    std::size_t balance(Item const& item, std::size_t s) const {
+        if (s >= _subject.size() || _subject[s] != item._open) {
+            return std::string_view::npos;
+        }
+
+        unsigned int depth = 1;
+        for (++s; s < _subject.size(); ++s) {
+            if (_subject[s] == item._close) {
+                if (--depth == 0) {
+                    return s + 1;
+                }
+            } else if (_subject[s] == item._open) {
+                ++depth;
+            }
+        }
+
+        return std::string_view::npos;
+    }
+
+    Program const& _program;
+    std::string_view _subject;
+    Match& _match;
+    unsigned int _depth = 0;
+    std::size_t _end = 0;
+};
+
+Program::Program(std::string_view pattern) : _pattern(pattern) {
+    std::size_t i = 0;
+    if (!pattern.empty() && pattern[0] == '^') {
+        _anchored = true;
+        ++i;
+    }
+
+    std::vector<std::size_t> open;
+    auto new_capture = [&]() {
+        if (_captures == MaxCaptures) {
+            throw Exceptions::MalformedPattern(_pattern, "too many captures");
+        }
+        return _captures++;
+    };
+
+    while (i < pattern.size()) {
+        Item item;
+        char c = pattern[i];
+        if (c == '(') {
+            if (i + 1 < pattern.size() && pattern[i + 1] == ')') {
+                item._kind = Kind::POSITION;
+                item._capture = new_capture();
+                i += 2;
+            } else {
+                item._kind = Kind::OPEN;
+                item._capture = new_capture();
+                open.push_back(item._capture);
+                ++i;
+            }
+        } else if (c == ')') {
+            if (open.empty()) {
+                throw Exceptions::MalformedPattern(_pattern, "invalid pattern capture");
+            }
+            item._kind = Kind::CLOSE;
+            item._capture = open.back();
+            open.pop_back();
+            ++i;
+        } else if (c == '$' && i + 1 == pattern.size()) {
+            item._kind = Kind::END;
+            ++i;
+        } else if (c == '%' && i + 1 < pattern.size() && pattern[i + 1] == 'b') {
+            if (i + 3 >= pattern.size()) {
+                throw Exceptions::MalformedPattern(_pattern, "missing arguments to '%b'");
+            }
+            item._kind = Kind::BALANCE;
+            item._open = pattern[i + 2];
+            item._close = pattern[i + 3];
+            i += 4;
+        } else if (c == '%' && i + 1 < pattern.size() && pattern[i + 1] == 'f') {
+            if (i + 2 >= pattern.size() || pattern[i + 2] != '[') {
+                throw Exceptions::MalformedPattern(_pattern, "missing '[' after '%f' in pattern");
+            }
+            item._kind = Kind::FRONTIER;
+            i = set(pattern, i + 2, item._set);
+        } else if (c == '%' && i + 1 < pattern.size() && pattern[i + 1] >= '1' && pattern[i + 1] <= '9') {
+            std::size_t capture = pattern[i + 1] - '1';
+            if (capture >= _captures || std::find(open.begin(), open.end(), capture) != open.end()) {
+                throw Exceptions::MalformedPattern(_pattern, "invalid capture index %" + std::to_string(capture + 1));
+            }
+            item._kind = Kind::BACKREFERENCE;
+            item._capture = capture;
+            i += 2;
+        } else {
+            item._kind = Kind::SINGLE;
+            i = single(pattern, i, item._set);
+            if (i < pattern.size() && (pattern[i] == '*' || pattern[i] == '+' || pattern[i] == '-' || pattern[i] == '?')) {
+                item._quantifier = pattern[i++];
+            }
+        }
+
+        _items.push_back(std::move(item));
+    }
+
+    if (!open.empty()) {
+        throw Exceptions::MalformedPattern(_pattern, "unfinished capture");
+    }
+
+    // Captures match the empty string, look through them for the first
+    // characters of the matches.
+    for (Item const& item: _items) {
+        if (item._kind == Kind::OPEN || item._kind == Kind::CLOSE || item._kind == Kind::POSITION) {
+            continue;
+        } else if (item._kind != Kind::SINGLE || (item._quantifier != '\0' && item._quantifier != '+')) {
+            break;
+        }
+
+        if (!_has_first) {
+            _has_first = true;
+            _first = item._set;
+        }
+
+        if (item._set.count() != 1) {
+            break;
+        }
+
+        for (int c = 0; c < 256; ++c) {
+            if (item._set[c]) {
+                _prefix.push_back(static_cast<char>(c));
+                break;
+            }
+        }
+
+        if (item._quantifier == '+') {
+            break;
+        }
+    }
+}
+
+std::size_t Program::single(std::string_view pattern, std::size_t i, Set& set) const {
+    char c = pattern[i];
+    if (c == '.') {
+        set.set();
+        return i + 1;
+    } else if (c == '[') {
+        return this->set(pattern, i, set);
+    } else if (c == '%') {
+        if (i + 1 >= pattern.size()) {
+            throw Exceptions::MalformedPattern(_pattern, "ends with '%'");
+        }
+        if (!add_class(pattern[i + 1], set)) {
+            set.set(byte(pattern[i + 1]));
+        }
+        return i + 2;
+    }
+
+    set.set(byte(c));
+    return i + 1;
+}
+
+// Set [...] starting at position i. Returns the position after the closing
+// bracket.
+std::size_t Program::set(std::string_view pattern, std::size_t i, Set& set) const {
+    ++i;
+    bool complement = i < pattern.size() && pattern[i] == '^';
+    if (complement) {
+        ++i;
+    }
+
+    // A ] right after the opening bracket is a character of the set.
+    bool first = true;
+    for (;;) {
+        if (i >= pattern.size()) {
+            throw Exceptions::MalformedPattern(_pattern, "missing ']'");
+        }
+
+        char c = pattern[i];
+        if (c == ']' && !first) {
+            break;
+        }
+        first = false;
+
+        if (c == '%') {
+            if (i + 1 >= pattern.size()) {
+                throw Exceptions::MalformedPattern(_pattern, "missing ']'");
+            }
+            if (!add_class(pattern[i + 1], set)) {
+                set.set(byte(pattern[i + 1]));
+            }
+            i += 2;
+        } else if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            for (int b = byte(c); b <= byte(pattern[i + 2]); ++b) {
+                set.set(b);
+            }
+            i += 3;
+        } else {
+            set.set(byte(c));
+            ++i;
+        }
+    }
+
+    if (complement) {
+        set.flip();
+    }
+
+    return i + 1;
+}
+
+bool Program::match_at(std::string_view subject, std::size_t at, Match& match) const {
+    for (std::size_t i = 0; i < _captures; ++i) {
+        match._captures[i] = Capture();
+    }
+
+    Matcher matcher(*this, subject, match);
+    if (!matcher.match(0, at)) {
+        return false;
+    }
+
+    match._start = at;
+    match._end = matcher.end();
+    return true;
+}
+
+bool Program::find(std::string_view subject, std::size_t from, Match& match) const {
+    if (from > subject.size()) {
+        return false;
+    } else if (_anchored) {
+        return match_at(subject, from, match);
+    }
+
+    if (!_prefix.empty()) {
+        for (;;) {
+            std::size_t position = StringSearch::find(subject, _prefix, from);
+            if (position == std::string_view::npos) {
+                return false;
+            } else if (match_at(subject, position, match)) {
+                return true;
+            }
+            from = position + 1;
+        }
+    }
+
+    for (std::size_t position = from; position <= subject.size(); ++position) {
+        if (_has_first && (position == subject.size() || !_first[byte(subject[position])])) {
+            continue;
+        } else if (match_at(subject, position, match)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::shared_ptr<Program const> compile(Types::String const& pattern) {
+    static std::unordered_map<Types::String, std::shared_ptr<Program const>, Types::String::Hash> cache;
+
+    auto iter = cache.find(pattern);
+    if (iter != cache.end()) {
+        return iter->second;
+    }
+
+    auto program = std::make_shared<Program const>(pattern.view());
+    if (cache.size() == MaxCachedPrograms) {
+        cache.clear();
+    }
+    cache.emplace(pattern, program);
+    return program;
+}
+
+bool is_plain(std::string_view pattern) {
+    return pattern.find_first_of("^$*+?.([%-") == std::string_view::npos;
+}
+
+}
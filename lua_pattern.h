@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "interned_string.h"
+
+/* Lua patterns, compiled once into a sequence of items that the matcher
+ * walks with backtracking, as the reference implementation does with the
+ * text of the pattern. Every single character class ('.', %a, [set], a
+ * literal) is compiled to a 256 bits set.
+ */
+namespace Patterns {
+    constexpr std::size_t MaxCaptures = 32;
+
+    // Capture of a match, as bounds in the subject. Substrings are only
+    // built when the captures are returned to the script.
+    struct Capture {
+        static constexpr long Unfinished = -1;
+        static constexpr long Position = -2;
+
+        std::size_t _start = 0;
+        long _length = Unfinished;
+    };
+
+    struct Match {
+        std::size_t _start;
+        std::size_t _end;
+        std::array<Capture, MaxCaptures> _captures;
+    };
+
+    class Program {
+    public:
+        Program(std::string_view pattern);
+
+        // Match starting exactly at position at.
+        bool match_at(std::string_view subject, std::size_t at, Match& match) const;
+
+        // First match starting at or after from.
+        bool find(std::string_view subject, std::size_t from, Match& match) const;
+
+        bool anchored() const { return _anchored; }
+        std::size_t captures() const { return _captures; }
+
+    private:
+        enum class Kind {
+            SINGLE, // One character of a set, with an optional quantifier
+            OPEN, // (
+            CLOSE, // )
+            POSITION, // ()
+            BALANCE, // %bxy
+            FRONTIER, // %f[set]
+            BACKREFERENCE, // %1 - %9
+            END // $ at the end of the pattern
+        };
+
+        typedef std::bitset<256> Set;
+
+        struct Item {
+            Kind _kind;
+            Set _set;
+            char _quantifier = '\0';
+            std::size_t _capture = 0;
+            char _open = '\0';
+            char _close = '\0';
+        };
+
+        class Matcher;
+
+        std::size_t single(std::string_view pattern, std::size_t i, Set& set) const;
+        std::size_t set(std::string_view pattern, std::size_t i, Set& set) const;
+
+        std::string _pattern;
+        std::vector<Item> _items;
+        bool _anchored = false;
+        std::size_t _captures = 0;
+
+        // Characters every match starts with, searched for with the
+        // vectorized string search before trying to match.
+        std::string _prefix;
+
+        // Set of the first character of any match, if known.
+        bool _has_first = false;
+        Set _first;
+    };
+
+    // Program for the pattern, compiled on the first use and cached.
+    std::shared_ptr<Program const> compile(Types::String const& pattern);
+
+    // Whether the pattern has no magic characters, and can be searched for
+    // as a plain string.
+    bool is_plain(std::string_view pattern);
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "exceptions.h"
+#include "memory.h"
+
+namespace Memory {
+
+namespace {
+    thread_local Account* current_account = nullptr;
+
+    AccountId last_id = 0;
+
+    // Accounts not destroyed yet, by id. Never destroyed: objects released
+    // during static destruction look their account up.
+    std::unordered_map<AccountId, Account*>& accounts() {
+        static std::unordered_map<AccountId, Account*>* accounts = new std::unordered_map<AccountId, Account*>();
+        return *accounts;
+    }
+}
+
+Account::Account() : _id(++last_id) {
+    accounts().emplace(_id, this);
+}
+
+Account::~Account() {
+    accounts().erase(_id);
+}
+
+Account* Account::current() {
+    return current_account;
+}
+
+AccountId Account::current_id() {
+    return current_account ? current_account->_id : 0;
+}
+
+Account* Account::live(AccountId id) {
+    // Objects are mostly released while their account is current.
+    if (current_account && current_account->_id == id) {
+        return current_account;
+    }
+
+    auto iter = accounts().find(id);
+    return iter != accounts().end() ? iter->second : nullptr;
+}
+
+Account::Scope::Scope(Account& account) : _previous(current_account) {
+    current_account = &account;
+}
+
+Account::Scope::Scope(AccountId id) : _previous(current_account) {
+    current_account = live(id);
+}
+
+Account::Scope::~Scope() {
+    current_account = _previous;
+}
+
+void Account::charge(Kind kind, std::size_t bytes, std::size_t objects) {
+    if (_stats._limit && _stats._bytes + bytes > _stats._limit) {
+        throw Exceptions::MemoryLimit(_stats._limit);
+    }
+
+    std::size_t index = static_cast<std::size_t>(kind);
+    _stats._bytes += bytes;
+    _stats._peak = std::max(_stats._peak, _stats._bytes);
+    _stats._kind_bytes[index] += bytes;
+    _stats._objects[index] += objects;
+}
+
+void Account::credit(Kind kind, std::size_t bytes, std::size_t objects) {
+    std::size_t index = static_cast<std::size_t>(kind);
+    std::size_t released = std::min(_stats._kind_bytes[index], bytes);
+    _stats._bytes -= released;
+    _stats._kind_bytes[index] -= released;
+    _stats._objects[index] -= std::min(_stats._objects[index], objects);
+}
+
+void charge(Kind kind, std::size_t bytes, std::size_t objects) {
+    if (current_account) {
+        current_account->charge(kind, bytes, objects);
+    }
+}
+
+void credit(Kind kind, std::size_t bytes, std::size_t objects) {
+    if (current_account) {
+        current_account->credit(kind, bytes, objects);
+    }
+}
+
+void charge(AccountId account, Kind kind, std::size_t bytes, std::size_t objects) {
+    if (Account* owner = Account::live(account)) {
+        owner->charge(kind, bytes, objects);
+    }
+}
+
+void credit(AccountId account, Kind kind, std::size_t bytes, std::size_t objects) {
+    if (Account* owner = Account::live(account)) {
+        owner->credit(kind, bytes, objects);
+    }
+}
+
+AccountedResource::AccountedResource(Account& account, Kind kind, std::pmr::memory_resource* upstream) : _account(account), _kind(kind), _upstream(upstream) {
+
+}
+
+void* AccountedResource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    _account.charge(_kind, bytes, 1);
+    try {
+        return _upstream->allocate(bytes, alignment);
+    } catch (...) {
+        _account.credit(_kind, bytes, 1);
+        throw;
+    }
+}
+
+void AccountedResource::do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) {
+    _upstream->deallocate(pointer, bytes, alignment);
+    _account.credit(_kind, bytes, 1);
+}
+
+bool AccountedResource::do_is_equal(std::pmr::memory_resource const& other) const noexcept {
+    return this == &other;
+}
+
+}
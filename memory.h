@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+/* Accounting of the memory used by an interpreter. Each Interpreter has an
+ * Account, charged for the objects created while it runs (it is then the
+ * current account of the thread) and credited for the ones released.
+ *
+ * Tables, functions and the storage of strings remember the id of the
+ * account they were charged to, and credit it when they are released,
+ * whatever the current account. Ids are never reused, so that an account
+ * created where a destroyed one was is not credited for the objects of
+ * the destroyed one. The Values and other memory they own are credited to
+ * the same account: it is made current while they are released. Values
+ * of frames are released while their interpreter runs. Objects that
+ * outlive their account (strings shared with another interpreter) credit
+ * nothing. Accounts never go below zero.
+ */
+namespace Memory {
+    enum class Kind {
+        VALUE, // Heap allocated Values: locals, globals, fields of tables
+        TABLE, // Tables, and the storage of their string keyed fields
+        FUNCTION, // Closures and native functions
+        STRING, // Characters of strings
+        FRAME, // Memory of the pool the frames of calls are taken from
+        COUNT
+    };
+
+    // Identifies an account for the lifetime of the process. 0 for none.
+    using AccountId = std::uint64_t;
+
+    struct Stats {
+        std::size_t _bytes = 0; // Bytes currently used
+        std::size_t _peak = 0; // Largest number of bytes used at once
+        std::size_t _limit = 0; // 0 if there is no limit
+        // Bytes and number of objects currently used, by kind.
+        std::array<std::size_t, static_cast<std::size_t>(Kind::COUNT)> _kind_bytes = { };
+        std::array<std::size_t, static_cast<std::size_t>(Kind::COUNT)> _objects = { };
+    };
+
+    class Account {
+    public:
+        Account();
+        ~Account();
+        Account(Account const&) = delete;
+        Account& operator=(Account const&) = delete;
+
+        // Account charged by the thread, null if there is none.
+        static Account* current();
+        // Its id, 0 if there is none.
+        static AccountId current_id();
+
+        // Account of id if it has not been destroyed, null otherwise.
+        static Account* live(AccountId id);
+
+        AccountId id() const { return _id; }
+
+        // Makes an account the current one of the thread for its lifetime.
+        class Scope {
+        public:
+            Scope(Account& account);
+            // Makes no account current if the account of id is destroyed.
+            Scope(AccountId id);
+            ~Scope();
+
+            Scope(Scope const&) = delete;
+            Scope& operator=(Scope const&) = delete;
+
+        private:
+            Account* _previous;
+        };
+
+        // Raises Exceptions::MemoryLimit, and leaves the account unchanged,
+        // if the charge would go over the limit.
+        void charge(Kind kind, std::size_t bytes, std::size_t objects);
+        void credit(Kind kind, std::size_t bytes, std::size_t objects);
+
+        // 0 for no limit.
+        void set_limit(std::size_t bytes) { _stats._limit = bytes; }
+
+        Stats const& stats() const { return _stats; }
+
+    private:
+        AccountId _id;
+        Stats _stats;
+    };
+
+    // Charge and credit the current account, if any. objects is 0 when an
+    // existing object grows or shrinks.
+    void charge(Kind kind, std::size_t bytes, std::size_t objects = 1);
+    void credit(Kind kind, std::size_t bytes, std::size_t objects = 1);
+
+    // Charge and credit the account an object remembers, if it has not been
+    // destroyed.
+    void charge(AccountId account, Kind kind, std::size_t bytes, std::size_t objects = 1);
+    void credit(AccountId account, Kind kind, std::size_t bytes, std::size_t objects = 1);
+
+    /* Memory resource that charges an account for the blocks it gets from
+     * its upstream, whatever the current account. Blocks count as objects.
+     */
+    class AccountedResource : public std::pmr::memory_resource {
+    public:
+        AccountedResource(Account& account, Kind kind, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+
+        Account& _account;
+        Kind _kind;
+        std::pmr::memory_resource* _upstream;
+    };
+}
@@ -0,0 +1,205 @@
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "exceptions.h"
+#include "operators.h"
+#include "types.h"
+
+namespace Operators {
+
+namespace {
+
+constexpr std::size_t TypeCount = std::variant_size_v<Types::LuaValue>;
+constexpr std::size_t OperatorCount = static_cast<std::size_t>(Binary::ERROR);
+
+template<std::size_t I>
+using TypeAt = std::variant_alternative_t<I, Types::LuaValue>;
+
+template<typename T>
+constexpr bool IsNumber = std::is_same_v<T, int> || std::is_same_v<T, double>;
+
+constexpr bool is_arithmetic(Binary op) {
+    return op == Binary::ADD || op == Binary::SUB || op == Binary::MUL;
+}
+
+constexpr bool is_bitwise(Binary op) {
+    return op == Binary::AND || op == Binary::OR || op == Binary::XOR ||
+        op == Binary::LSHIFT || op == Binary::RSHIFT;
+}
+
+constexpr bool is_equality(Binary op) {
+    return op == Binary::EQ || op == Binary::DIFF;
+}
+
+constexpr bool is_ordering(Binary op) {
+    return op == Binary::LOWER_S || op == Binary::LOWER_E ||
+        op == Binary::GREATER_S || op == Binary::GREATER_E;
+}
+
+template<Binary Op, typename T>
+constexpr T arithmetic(T left, T right) {
+    if constexpr (Op == Binary::ADD) {
+        return left + right;
+    } else if constexpr (Op == Binary::SUB) {
+        return left - right;
+    } else {
+        return left * right;
+    }
+}
+
+template<Binary Op>
+constexpr int bitwise(int left, int right) {
+    if constexpr (Op == Binary::AND) {
+        return left & right;
+    } else if constexpr (Op == Binary::OR) {
+        return left | right;
+    } else if constexpr (Op == Binary::XOR) {
+        return left ^ right;
+    } else if constexpr (Op == Binary::LSHIFT) {
+        return left << right;
+    } else {
+        return left >> right;
+    }
+}
+
+template<Binary Op, typename T>
+constexpr bool ordering(T const& left, T const& right) {
+    if constexpr (Op == Binary::LOWER_S) {
+        return left < right;
+    } else if constexpr (Op == Binary::LOWER_E) {
+        return left <= right;
+    } else if constexpr (Op == Binary::GREATER_S) {
+        return left > right;
+    } else {
+        return left >= right;
+    }
+}
+
+// Read an operand known to be an int or a double as a double.
+template<typename T>
+double number(Types::Value const& value) {
+    return static_cast<double>(value.as<T>());
+}
+
+template<std::size_t L, std::size_t R>
+bool equals(Types::Value const& left, Types::Value const& right) {
+    using Left = TypeAt<L>;
+    using Right = TypeAt<R>;
+
+    if constexpr (IsNumber<Left> && IsNumber<Right>) {
+        return number<Left>(left) == number<Right>(right);
+    } else if constexpr (!std::is_same_v<Left, Right>) {
+        // No conversion between strings and numbers for equality.
+        return false;
+    } else if constexpr (std::is_same_v<Left, Types::Nil>) {
+        return true;
+    } else if constexpr (std::is_same_v<Left, Types::Elipsis>) {
+        return false;
+    } else {
+        // Interned strings and references by identity.
+        return left.as<Left>() == right.as<Right>();
+    }
+}
+
+/* Kernel for a given operator and pair of operand types. Number operands
+ * are read directly from the variant; any other combination goes through
+ * the weak conversions of Types::Value, which either coerce (strings) or
+ * raise a BadTypeException.
+ */
+template<Binary Op, std::size_t L, std::size_t R>
+Types::Value binary(Types::Value const& left, Types::Value const& right) {
+    using Left = TypeAt<L>;
+    using Right = TypeAt<R>;
+    constexpr bool ints = std::is_same_v<Left, int> && std::is_same_v<Right, int>;
+    constexpr bool numbers = IsNumber<Left> && IsNumber<Right>;
+
+    if constexpr (is_arithmetic(Op)) {
+        if constexpr (ints) {
+            return Types::Value::make_int(arithmetic<Op>(left.as<int>(), right.as<int>()));
+        } else if constexpr (numbers) {
+            return Types::Value::make_double(arithmetic<Op>(number<Left>(left), number<Right>(right)));
+        } else {
+            return Types::Value::make_double(arithmetic<Op>(left.as_double_weak(), right.as_double_weak()));
+        }
+    } else if constexpr (Op == Binary::DIV || Op == Binary::MOD || Op == Binary::QUOT || Op == Binary::POWER) {
+        if constexpr (ints && Op == Binary::MOD) {
+            return Types::Value::make_int(left.as<int>() % right.as<int>());
+        } else if constexpr (ints && Op == Binary::QUOT) {
+            return Types::Value::make_int(std::floor(number<int>(left) / number<int>(right)));
+        } else {
+            double x, y;
+            if constexpr (numbers) {
+                x = number<Left>(left);
+                y = number<Right>(right);
+            } else {
+                x = left.as_double_weak();
+                y = right.as_double_weak();
+            }
+
+            if constexpr (Op == Binary::DIV) {
+                return Types::Value::make_double(x / y);
+            } else if constexpr (Op == Binary::MOD) {
+                return Types::Value::make_double(std::remainder(x, y));
+            } else if constexpr (Op == Binary::QUOT) {
+                return Types::Value::make_double(std::floor(x / y));
+            } else {
+                return Types::Value::make_double(std::pow(x, y));
+            }
+        }
+    } else if constexpr (Op == Binary::STRCAT) {
+        if constexpr (std::is_same_v<Left, Types::String> && std::is_same_v<Right, Types::String>) {
+            return Types::Value::make_string(Types::String::concat(left.as<Types::String>(), right.as<Types::String>().view()));
+        } else if constexpr (std::is_same_v<Left, Types::String>) {
+            return Types::Value::make_string(Types::String::concat(left.as<Types::String>(), right.as_string()));
+        } else {
+            return Types::Value::make_string(left.as_string() + right.as_string());
+        }
+    } else if constexpr (is_bitwise(Op)) {
+        if constexpr (ints) {
+            return Types::Value::make_int(bitwise<Op>(left.as<int>(), right.as<int>()));
+        } else {
+            return Types::Value::make_int(bitwise<Op>(left.as_int_weak(), right.as_int_weak()));
+        }
+    } else if constexpr (is_equality(Op)) {
+        return Types::Value::make_bool(equals<L, R>(left, right) == (Op == Binary::EQ));
+    } else if constexpr (is_ordering(Op)) {
+        if constexpr (numbers) {
+            return Types::Value::make_bool(ordering<Op>(number<Left>(left), number<Right>(right)));
+        } else if constexpr (std::is_same_v<Left, Types::String> && std::is_same_v<Right, Types::String>) {
+            return Types::Value::make_bool(ordering<Op>(left.as<Types::String>(), right.as<Types::String>()));
+        } else {
+            throw Exceptions::ContextlessBadTypeException("two numbers or two strings", left.type_as_string() + " and " + right.type_as_string());
+        }
+    }
+}
+
+typedef std::array<Kernel, TypeCount * TypeCount> KernelRow;
+
+template<Binary Op, std::size_t... I>
+constexpr KernelRow make_row(std::index_sequence<I...>) {
+    return { &binary<Op, I / TypeCount, I % TypeCount>... };
+}
+
+template<std::size_t... O>
+constexpr std::array<KernelRow, OperatorCount> make_table(std::index_sequence<O...>) {
+    return { make_row<static_cast<Binary>(O)>(std::make_index_sequence<TypeCount * TypeCount>())... };
+}
+
+constexpr std::array<KernelRow, OperatorCount> kernels = make_table(std::make_index_sequence<OperatorCount>());
+
+}
+
+Kernel kernel(Binary op, std::size_t left, std::size_t right) {
+    if (op == Binary::ERROR) {
+        throw std::runtime_error("Invalid binary operator");
+    }
+
+    return kernels[static_cast<std::size_t>(op)][left * TypeCount + right];
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+
+#include "types.h"
+
+namespace Operators {
+    // Every binary operator except the short-circuiting and / or.
+    enum class Binary {
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        QUOT,
+        POWER,
+        STRCAT,
+        AND,
+        OR,
+        XOR,
+        LSHIFT,
+        RSHIFT,
+        EQ,
+        DIFF,
+        LOWER_S,
+        LOWER_E,
+        GREATER_S,
+        GREATER_E,
+        ERROR
+    };
+
+    typedef Types::Value (*Kernel)(Types::Value const& left, Types::Value const& right);
+
+    /* Kernel specialized for the operator and the type tags of both operands
+     * (the index of the alternative held by each LuaValue). Kernels are
+     * generated at compile time, one per (operator, left type, right type),
+     * so that dispatching is a single table lookup.
+     */
+    Kernel kernel(Binary op, std::size_t left, std::size_t right);
+
+    inline Types::Value apply(Binary op, Types::Value const& left, Types::Value const& right) {
+        return kernel(op, left.value().index(), right.value().index())(left, right);
+    }
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+/* Pattern-defeating quicksort (Orson Peters): an introsort that detects
+ * already partitioned ranges and finishes them with a bounded insertion
+ * sort, groups the values equal to the pivot in a single pass, and falls
+ * back to heapsort after too many unbalanced partitions.
+ *
+ * Unlike std::sort, every scan is bounded by the range. The comparison may
+ * be a Lua function, which is free not to be a strict weak order (or to
+ * change its mind from one call to the next): the result is then
+ * unspecified, but the sort stays within the range. It may also throw, in
+ * which case the range holds a permutation of its values.
+ */
+namespace Sorting {
+    namespace Detail {
+        // Ranges smaller than this are sorted by insertion.
+        constexpr std::ptrdiff_t InsertionSortThreshold = 24;
+
+        // Ranges larger than this take the pivot as a median of medians.
+        constexpr std::ptrdiff_t NintherThreshold = 128;
+
+        // Number of moves after which the insertion sort of an already
+        // partitioned range gives up.
+        constexpr std::ptrdiff_t PartialInsertionSortLimit = 8;
+
+        template<typename Iterator, typename Less>
+        void insertion_sort(Iterator begin, Iterator end, Less& less) {
+            if (begin == end) {
+                return;
+            }
+
+            for (Iterator current = begin + 1; current != end; ++current) {
+                if (less(*current, *(current - 1))) {
+                    auto value = std::move(*current);
+                    Iterator hole = current;
+                    do {
+                        *hole = std::move(*(hole - 1));
+                        --hole;
+                    } while (hole != begin && less(value, *(hole - 1)));
+                    *hole = std::move(value);
+                }
+            }
+        }
+
+        // As insertion_sort, but returns false without finishing if it
+        // had to move more than PartialInsertionSortLimit values.
+        template<typename Iterator, typename Less>
+        bool partial_insertion_sort(Iterator begin, Iterator end, Less& less) {
+            if (begin == end) {
+                return true;
+            }
+
+            std::ptrdiff_t moves = 0;
+            for (Iterator current = begin + 1; current != end; ++current) {
+                if (less(*current, *(current - 1))) {
+                    auto value = std::move(*current);
+                    Iterator hole = current;
+                    do {
+                        *hole = std::move(*(hole - 1));
+                        --hole;
+                    } while (hole != begin && less(value, *(hole - 1)));
+                    *hole = std::move(value);
+                    moves += current - hole;
+                }
+
+                if (moves > PartialInsertionSortLimit) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        template<typename Iterator, typename Less>
+        void sort2(Iterator a, Iterator b, Less& less) {
+            if (less(*b, *a)) {
+                std::iter_swap(a, b);
+            }
+        }
+
+        // Leaves the median of the three values in b.
+        template<typename Iterator, typename Less>
+        void sort3(Iterator a, Iterator b, Iterator c, Less& less) {
+            sort2(a, b, less);
+            sort2(b, c, less);
+            sort2(a, b, less);
+        }
+
+        /* Partition around the first value of the range: the values less
+         * than the pivot go to its left, the others to its right. Returns
+         * the position of the pivot, and whether the range was already
+         * partitioned.
+         */
+        template<typename Iterator, typename Less>
+        std::pair<Iterator, bool> partition_right(Iterator begin, Iterator end, Less& less) {
+            auto pivot = std::move(*begin);
+            Iterator first = begin + 1;
+            Iterator last = end;
+
+            while (first != last && less(*first, pivot)) {
+                ++first;
+            }
+            while (first != last && !less(*(last - 1), pivot)) {
+                --last;
+            }
+
+            bool already_partitioned = first == last;
+            while (first != last) {
+                --last;
+                std::iter_swap(first, last);
+                ++first;
+
+                while (first != last && less(*first, pivot)) {
+                    ++first;
+                }
+                while (first != last && !less(*(last - 1), pivot)) {
+                    --last;
+                }
+            }
+
+            Iterator position = first - 1;
+            *begin = std::move(*position);
+            *position = std::move(pivot);
+            return std::make_pair(position, already_partitioned);
+        }
+
+        /* Partition around the first value of the range, with the values
+         * equal to the pivot on its left. Used when the value before the
+         * range is not less than the pivot: the left part then only holds
+         * values equal to it, and is sorted already.
+         */
+        template<typename Iterator, typename Less>
+        Iterator partition_left(Iterator begin, Iterator end, Less& less) {
+            auto pivot = std::move(*begin);
+            Iterator first = begin + 1;
+            Iterator last = end;
+
+            while (first != last && !less(pivot, *first)) {
+                ++first;
+            }
+            while (first != last && less(pivot, *(last - 1))) {
+                --last;
+            }
+
+            while (first != last) {
+                --last;
+                std::iter_swap(first, last);
+                ++first;
+
+                while (first != last && !less(pivot, *first)) {
+                    ++first;
+                }
+                while (first != last && less(pivot, *(last - 1))) {
+                    --last;
+                }
+            }
+
+            Iterator position = first - 1;
+            *begin = std::move(*position);
+            *position = std::move(pivot);
+            return position;
+        }
+
+        template<typename Iterator, typename Less>
+        void heap_sort(Iterator begin, Iterator end, Less& less) {
+            auto compare = [&less](auto const& left, auto const& right) { return less(left, right); };
+            std::make_heap(begin, end, compare);
+            std::sort_heap(begin, end, compare);
+        }
+
+        template<typename Iterator, typename Less>
+        void sort(Iterator begin, Iterator end, Less& less, int bad_allowed, bool leftmost) {
+            while (true) {
+                std::ptrdiff_t size = end - begin;
+                if (size < InsertionSortThreshold) {
+                    insertion_sort(begin, end, less);
+                    return;
+                }
+
+                // Move the pivot to the start of the range.
+                std::ptrdiff_t half = size / 2;
+                if (size > NintherThreshold) {
+                    sort3(begin, begin + half, end - 1, less);
+                    sort3(begin + 1, begin + (half - 1), end - 2, less);
+                    sort3(begin + 2, begin + (half + 1), end - 3, less);
+                    sort3(begin + (half - 1), begin + half, begin + (half + 1), less);
+                    std::iter_swap(begin, begin + half);
+                } else {
+                    sort3(begin + half, begin, end - 1, less);
+                }
+
+                if (!leftmost && !less(*(begin - 1), *begin)) {
+                    begin = partition_left(begin, end, less) + 1;
+                    continue;
+                }
+
+                auto [pivot, already_partitioned] = partition_right(begin, end, less);
+                std::ptrdiff_t left_size = pivot - begin;
+                std::ptrdiff_t right_size = end - (pivot + 1);
+
+                if (left_size < size / 8 || right_size < size / 8) {
+                    if (--bad_allowed == 0) {
+                        heap_sort(begin, end, less);
+                        return;
+                    }
+
+                    // Shuffle a few values around, to break the pattern
+                    // that made the partition unbalanced.
+                    if (left_size >= InsertionSortThreshold) {
+                        std::iter_swap(begin, begin + left_size / 4);
+                        std::iter_swap(pivot - 1, pivot - left_size / 4);
+                    }
+                    if (right_size >= InsertionSortThreshold) {
+                        std::iter_swap(pivot + 1, pivot + (1 + right_size / 4));
+                        std::iter_swap(end - 1, end - right_size / 4);
+                    }
+                } else if (already_partitioned &&
+                           partial_insertion_sort(begin, pivot, less) &&
+                           partial_insertion_sort(pivot + 1, end, less)) {
+                    return;
+                }
+
+                sort(begin, pivot, less, bad_allowed, leftmost);
+                begin = pivot + 1;
+                leftmost = false;
+            }
+        }
+    }
+
+    // Sort [begin, end) of a random access range, in place and unstable.
+    template<typename Iterator, typename Less>
+    void sort(Iterator begin, Iterator end, Less less) {
+        std::size_t size = end - begin;
+        if (size < 2) {
+            return;
+        }
+
+        Detail::sort(begin, end, less, std::bit_width(size), true);
+    }
+}
@@ -18,8 +18,8 @@ void c_print(Types::LuaValue const& value) {
         std::cout << "function: " << std::get<Types::Function*>(value) << std::endl;
     } else if (std::holds_alternative<Types::Table*>(value)) {
         std::cout << "table: " << std::get<Types::Table*>(value) << std::endl;
-    } else if (std::holds_alternative<std::string>(value)) {
-        std::cout << "string: " << std::get<std::string>(value) << std::endl;
+    } else if (std::holds_alternative<Types::String>(value)) {
+        std::cout << "string: " << std::get<Types::String>(value).str() << std::endl;
     } else if (std::holds_alternative<bool>(value)) {
         std::cout << "bool: " << std::boolalpha << std::get<bool>(value) << std::noboolalpha << std::endl;
     } else if (std::holds_alternative<Types::Nil>(value)) {
@@ -0,0 +1,63 @@
+#include "shape.h"
+
+namespace Types {
+
+Shape::Shape(Shape* parent, std::shared_ptr<Layout> layout, std::size_t size) : _parent(parent), _layout(std::move(layout)), _size(size) {
+    if (_parent) {
+        _parent->acquire();
+    }
+}
+
+Shape::~Shape() {
+    if (_parent) {
+        _parent->_transitions.erase(key(_size - 1));
+        _parent->release();
+    }
+}
+
+// The root is never released: it holds one more reference than its users.
+Shape* Shape::root() {
+    static Shape* root = new Shape(nullptr, std::make_shared<Layout>(), 0);
+    root->acquire();
+    return root;
+}
+
+/* The child shares the layout of this shape if this shape is the last one to
+ * have extended it, or if the next key of the layout is key already (the
+ * child was created, then released). Otherwise, the keys of this shape are
+ * copied into a new layout.
+ */
+Shape* Shape::add(String const& key) {
+    auto iter = _transitions.find(key);
+    if (iter != _transitions.end()) {
+        iter->second->acquire();
+        return iter->second;
+    }
+
+    std::shared_ptr<Layout> layout = _layout;
+    if (layout->_keys.size() == _size) {
+        layout->_keys.push_back(key);
+        layout->_slots.emplace(key, _size);
+    } else if (layout->_keys[_size] != key) {
+        layout = std::make_shared<Layout>();
+        layout->_keys.reserve(_size + 1);
+        for (std::size_t slot = 0; slot < _size; ++slot) {
+            layout->_keys.push_back(_layout->_keys[slot]);
+            layout->_slots.emplace(_layout->_keys[slot], slot);
+        }
+        layout->_keys.push_back(key);
+        layout->_slots.emplace(key, _size);
+    }
+
+    Shape* child = new Shape(this, std::move(layout), _size + 1);
+    _transitions.emplace(key, child);
+    return child;
+}
+
+void Shape::release() {
+    if (--_references == 0) {
+        delete this;
+    }
+}
+
+}
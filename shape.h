@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "interned_string.h"
+
+namespace Types {
+    /* Hidden class of a table: the string keys it got through the dot syntax
+     * (t.x = v, or x = v in a constructor), in the order they were added.
+     * Tables that got the same keys in the same order share their Shape, and
+     * only store their values, each in the slot of its key.
+     *
+     * Shapes form a tree rooted at the empty shape. Adding a key to a table
+     * moves it to the child of its shape for this key, created the first time
+     * and found in the transitions of the shape afterwards. The keys and
+     * their slots are kept in a Layout shared along a chain of shapes: a
+     * shape only sees the first size() keys of its layout, so a chain of
+     * shapes built one key at a time stores each key once.
+     *
+     * Shapes are refcounted by the tables that have them and by their
+     * children. Like the intern table of Strings, they are not synchronized.
+     */
+    class Shape {
+    public:
+        Shape(Shape const&) = delete;
+        Shape& operator=(Shape const&) = delete;
+
+        // Shape without keys. The caller gets a reference to it.
+        static Shape* root();
+
+        // Slot of key, or -1 if the shape does not have it.
+        long find(String const& key) const {
+            if (_size == 0) {
+                return -1;
+            }
+
+            auto iter = _layout->_slots.find(key);
+            return iter != _layout->_slots.end() && iter->second < _size ? static_cast<long>(iter->second) : -1;
+        }
+
+        // The shape with key added after the keys of this one, which must not
+        // have it. The caller gets a reference to it.
+        Shape* add(String const& key);
+
+        std::size_t size() const { return _size; }
+
+        String const& key(std::size_t slot) const { return _layout->_keys[slot]; }
+
+        void acquire() { ++_references; }
+        void release();
+
+    private:
+        struct Layout {
+            std::vector<String> _keys;
+            std::unordered_map<String, std::size_t, String::Hash> _slots;
+        };
+
+        Shape(Shape* parent, std::shared_ptr<Layout> layout, std::size_t size);
+        ~Shape();
+
+        Shape* _parent;
+        std::shared_ptr<Layout> _layout;
+        std::size_t _size;
+        unsigned int _references = 1;
+
+        // Children, by the key they add. They remove themselves when they
+        // are released for the last time.
+        std::unordered_map<String, Shape*, String::Hash> _transitions;
+    };
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// AddressSanitizer cannot see use after free inside slabs: objects are
+// allocated one by one under it.
+#if defined(__SANITIZE_ADDRESS__)
+#define SLAB_ALLOCATOR_DISABLED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SLAB_ALLOCATOR_DISABLED 1
+#endif
+#endif
+
+struct SlabStats {
+    std::size_t _slot_size = 0; // Bytes per object
+    std::size_t _chunks = 0; // Chunks currently held
+    std::size_t _live = 0; // Objects currently allocated
+    std::size_t _peak = 0; // Largest number of objects allocated at once
+    std::size_t _allocations = 0; // Objects allocated since the start
+};
+
+/* While a SlabRemoteFrees is alive, the objects released by its thread are
+ * not returned to their slabs but queued on their allocator, that takes them
+ * back on its next allocation. This lets a thread other than the one running
+ * the interpreters free objects.
+ */
+class SlabRemoteFrees {
+public:
+    SlabRemoteFrees() { _active = true; }
+    ~SlabRemoteFrees() { _active = false; }
+
+    SlabRemoteFrees(SlabRemoteFrees const&) = delete;
+    SlabRemoteFrees& operator=(SlabRemoteFrees const&) = delete;
+
+    static bool active() { return _active; }
+
+private:
+    static inline thread_local bool _active = false;
+};
+
+/* Allocator of fixed size objects of type T, carved from chunks of
+ * ChunkSize bytes aligned on their size, so that the chunk of an object is
+ * found by masking its address. Each chunk has its own free list and count
+ * of objects in use. Chunks with free slots are linked together, and the
+ * allocator takes from the first one; chunks that become empty are only
+ * returned to the system by release_unused().
+ *
+ * Objects may be released during static destruction, so the allocators are
+ * never destroyed. They are not synchronized, except for the queue of the
+ * objects released under a SlabRemoteFrees.
+ */
+template<typename T>
+class SlabAllocator {
+public:
+    // Large enough for the system allocator to map chunks on their own: the
+    // padding it adds to align them is never touched.
+    static constexpr std::size_t ChunkSize = 1 << 18;
+
+    static SlabAllocator& instance() {
+        static SlabAllocator* allocator = new SlabAllocator();
+        return *allocator;
+    }
+
+    void* allocate() {
+        if (_remote.load(std::memory_order_relaxed)) {
+            reclaim();
+        }
+
+        ++_stats._live;
+        ++_stats._allocations;
+        _stats._peak = std::max(_stats._peak, _stats._live);
+
+#ifdef SLAB_ALLOCATOR_DISABLED
+        return ::operator new(sizeof(T));
+#else
+        Chunk* chunk = _partial;
+        if (!chunk) {
+            chunk = add_chunk();
+        }
+
+        Slot* slot = chunk->_free;
+        if (slot) {
+            chunk->_free = slot->_next;
+        } else {
+            slot = chunk->slots() + chunk->_carved++;
+        }
+
+        if (++chunk->_used == SlotsPerChunk) {
+            unlink(chunk);
+        }
+
+        return slot;
+#endif
+    }
+
+    void deallocate(void* pointer) {
+        if (SlabRemoteFrees::active()) {
+            Slot* slot = static_cast<Slot*>(pointer);
+            slot->_next = _remote.load(std::memory_order_relaxed);
+            while (!_remote.compare_exchange_weak(slot->_next, slot, std::memory_order_release, std::memory_order_relaxed)) { }
+            return;
+        }
+
+        --_stats._live;
+
+#ifdef SLAB_ALLOCATOR_DISABLED
+        ::operator delete(pointer);
+#else
+        Slot* slot = static_cast<Slot*>(pointer);
+        Chunk* chunk = reinterpret_cast<Chunk*>(reinterpret_cast<std::uintptr_t>(pointer) & ~(ChunkSize - 1));
+        if (chunk->_used-- == SlotsPerChunk) {
+            link(chunk);
+        }
+
+        slot->_next = chunk->_free;
+        chunk->_free = slot;
+#endif
+    }
+
+    // Take back the objects released under a SlabRemoteFrees.
+    void reclaim() {
+        Slot* slot = _remote.exchange(nullptr, std::memory_order_acquire);
+        while (slot) {
+            Slot* next = slot->_next;
+            deallocate(slot);
+            slot = next;
+        }
+    }
+
+    // Return the chunks without objects to the system.
+    void release_unused() {
+        reclaim();
+
+        Chunk* chunk = _partial;
+        while (chunk) {
+            Chunk* next = chunk->_next;
+            if (chunk->_used == 0) {
+                unlink(chunk);
+                ::operator delete(chunk, std::align_val_t(ChunkSize));
+                --_stats._chunks;
+            }
+            chunk = next;
+        }
+    }
+
+    SlabStats stats() const { return _stats; }
+
+private:
+    union Slot {
+        Slot* _next;
+        alignas(T) unsigned char _storage[sizeof(T)];
+    };
+
+    struct Chunk {
+        Chunk* _previous;
+        Chunk* _next;
+        Slot* _free; // Released slots
+        std::size_t _carved; // Slots handed out at least once
+        std::size_t _used;
+
+        Slot* slots() { return reinterpret_cast<Slot*>(reinterpret_cast<unsigned char*>(this) + HeaderSize); }
+    };
+
+    static constexpr std::size_t HeaderSize = (sizeof(Chunk) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+    static constexpr std::size_t SlotsPerChunk = (ChunkSize - HeaderSize) / sizeof(Slot);
+
+    SlabAllocator() {
+        _stats._slot_size = sizeof(Slot);
+    }
+
+    Chunk* add_chunk() {
+        Chunk* chunk = static_cast<Chunk*>(::operator new(ChunkSize, std::align_val_t(ChunkSize)));
+        chunk->_previous = nullptr;
+        chunk->_next = nullptr;
+        chunk->_free = nullptr;
+        chunk->_carved = 0;
+        chunk->_used = 0;
+        link(chunk);
+        ++_stats._chunks;
+        return chunk;
+    }
+
+    void link(Chunk* chunk) {
+        chunk->_previous = nullptr;
+        chunk->_next = _partial;
+        if (_partial) {
+            _partial->_previous = chunk;
+        }
+        _partial = chunk;
+    }
+
+    void unlink(Chunk* chunk) {
+        if (chunk->_previous) {
+            chunk->_previous->_next = chunk->_next;
+        } else {
+            _partial = chunk->_next;
+        }
+        if (chunk->_next) {
+            chunk->_next->_previous = chunk->_previous;
+        }
+    }
+
+    // Chunks with at least one free slot.
+    Chunk* _partial = nullptr;
+    // Objects released under a SlabRemoteFrees, linked through their slots.
+    std::atomic<Slot*> _remote = nullptr;
+    SlabStats _stats;
+};
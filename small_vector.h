@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+/* Contiguous sequence that stores up to N elements inline, and only spills
+ * to the heap beyond that. Used for argument and result lists, that hold a
+ * handful of values in the vast majority of calls.
+ *
+ * Only the subset of the std::vector interface required by the interpreter
+ * is provided. As with std::vector, growing invalidates iterators.
+ */
+template<typename T, std::size_t N>
+class SmallVector {
+public:
+    typedef T value_type;
+    typedef std::size_t size_type;
+    typedef T& reference;
+    typedef T const& const_reference;
+    typedef T* iterator;
+    typedef T const* const_iterator;
+
+    SmallVector() { }
+
+    SmallVector(std::initializer_list<T> values) {
+        assign(values.begin(), values.end());
+    }
+
+    template<typename It>
+    SmallVector(It first, It last) {
+        assign(first, last);
+    }
+
+    SmallVector(SmallVector const& other) {
+        assign(other.begin(), other.end());
+    }
+
+    SmallVector(SmallVector&& other) {
+        steal(std::move(other));
+    }
+
+    ~SmallVector() {
+        clear();
+        release();
+    }
+
+    SmallVector& operator=(SmallVector const& other) {
+        if (this != &other) {
+            clear();
+            assign(other.begin(), other.end());
+        }
+
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) {
+        if (this != &other) {
+            clear();
+            release();
+            steal(std::move(other));
+        }
+
+        return *this;
+    }
+
+    template<typename It>
+    void assign(It first, It last) {
+        clear();
+        reserve(std::distance(first, last));
+        for (; first != last; ++first) {
+            ::new (_data + _size) T(*first);
+            ++_size;
+        }
+    }
+
+    void reserve(size_type capacity) {
+        if (capacity <= _capacity) {
+            return;
+        }
+
+        T* data = static_cast<T*>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+        std::uninitialized_move(begin(), end(), data);
+        std::destroy(begin(), end());
+        release();
+
+        _data = data;
+        _capacity = capacity;
+    }
+
+    void push_back(T const& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (_size == _capacity) {
+            // The arguments may refer to an element of the container.
+            T value(std::forward<Args>(args)...);
+            reserve(_capacity * 2);
+            return *::new (_data + _size++) T(std::move(value));
+        }
+
+        return *::new (_data + _size++) T(std::forward<Args>(args)...);
+    }
+
+    void resize(size_type size, T const& value) {
+        while (_size > size) {
+            pop_back();
+        }
+
+        reserve(size);
+        while (_size < size) {
+            ::new (_data + _size) T(value);
+            ++_size;
+        }
+    }
+
+    void pop_back() {
+        _data[--_size].~T();
+    }
+
+    void clear() {
+        std::destroy(begin(), end());
+        _size = 0;
+    }
+
+    T& operator[](size_type index) { return _data[index]; }
+    T const& operator[](size_type index) const { return _data[index]; }
+
+    T& front() { return _data[0]; }
+    T const& front() const { return _data[0]; }
+
+    T& back() { return _data[_size - 1]; }
+    T const& back() const { return _data[_size - 1]; }
+
+    T* data() { return _data; }
+    T const* data() const { return _data; }
+
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+
+    size_type size() const { return _size; }
+    size_type capacity() const { return _capacity; }
+    bool empty() const { return _size == 0; }
+
+    // Whether the elements are stored inline.
+    bool small() const { return _data == inline_data(); }
+
+private:
+    T* inline_data() { return reinterpret_cast<T*>(_inline); }
+    T const* inline_data() const { return reinterpret_cast<T const*>(_inline); }
+
+    // Free the heap buffer, if any. Elements must have been destroyed.
+    void release() {
+        if (!small()) {
+            ::operator delete(_data, std::align_val_t(alignof(T)));
+            _data = inline_data();
+            _capacity = N;
+        }
+    }
+
+    // Take the content of other, leaving it empty. *this must be empty and
+    // use its inline storage.
+    void steal(SmallVector&& other) {
+        if (other.small()) {
+            std::uninitialized_move(other.begin(), other.end(), _data);
+            _size = other._size;
+            other.clear();
+        } else {
+            _data = other._data;
+            _size = other._size;
+            _capacity = other._capacity;
+            other._data = other.inline_data();
+            other._size = 0;
+            other._capacity = N;
+        }
+    }
+
+    alignas(T) std::byte _inline[N * sizeof(T)];
+    T* _data = inline_data();
+    size_type _size = 0;
+    size_type _capacity = N;
+};
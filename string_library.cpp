@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include "builtins.h"
+#include "exceptions.h"
+#include "interpreter.h"
+#include "lua_pattern.h"
+#include "string_search.h"
+#include "types.h"
+
+namespace Builtins {
+
+namespace {
+
+Types::VarList result(Types::Value&& value) {
+    Types::VarList results;
+    results.push_back(Types::Var::make(std::move(value)));
+    return results;
+}
+
+Types::VarList result(std::string_view string) {
+    return result(Types::Value::make_string(Types::String(string)));
+}
+
+// Position relative to the end of the string if negative, as in Lua. The
+// result is a 1-based position that may be outside of the string.
+long relative(int position, size_t size) {
+    if (position >= 0) {
+        return position;
+    } else if (static_cast<size_t>(-static_cast<long>(position)) > size) {
+        return 0;
+    } else {
+        return static_cast<long>(size) + position + 1;
+    }
+}
+
+// Bounds [i, j] of a substring, 1-based and inclusive, clamped to the
+// string. Empty if i > j.
+std::pair<long, long> range(int i, int j, size_t size) {
+    long start = std::max(relative(i, size), 1L);
+    long end = std::min(relative(j, size), static_cast<long>(size));
+    return { start, end };
+}
+
+Types::Value capture(Types::String const& subject, Patterns::Match const& match, size_t index) {
+    Patterns::Capture const& capture = match._captures[index];
+    if (capture._length == Patterns::Capture::Position) {
+        return Types::Value::make_int(capture._start + 1);
+    }
+
+    return Types::Value::make_string(subject.sub(capture._start, capture._length));
+}
+
+// Captures of the match, or the whole match if the pattern has none. They
+// are slices of the subject.
+void push_captures(Types::VarList& results, Types::String const& subject, Patterns::Program const& program, Patterns::Match const& match) {
+    if (program.captures() == 0) {
+        results.push_back(Types::Var::make(Types::Value::make_string(subject.sub(match._start, match._end - match._start))));
+        return;
+    }
+
+    for (size_t i = 0; i < program.captures(); ++i) {
+        results.push_back(Types::Var::make(capture(subject, match, i)));
+    }
+}
+
+Types::VarList len(Interpreter&, std::span<Types::Value const> arguments) {
+    return result(Types::Value::make_int(check_string(arguments, 1, "len").size()));
+}
+
+Types::VarList sub(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::String string = check_string(arguments, 1, "sub");
+    auto [start, end] = range(check_int(arguments, 2, "sub"), opt_int(arguments, 3, "sub", -1), string.size());
+    if (start > end) {
+        return result(std::string_view());
+    }
+
+    return result(Types::Value::make_string(string.sub(start - 1, end - start + 1)));
+}
+
+Types::VarList upper(Interpreter&, std::span<Types::Value const> arguments) {
+    std::string string(check_string(arguments, 1, "upper").view());
+    for (char& c: string) {
+        if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+        }
+    }
+
+    return result(string);
+}
+
+Types::VarList lower(Interpreter&, std::span<Types::Value const> arguments) {
+    std::string string(check_string(arguments, 1, "lower").view());
+    for (char& c: string) {
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+    }
+
+    return result(string);
+}
+
+Types::VarList rep(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::String string = check_string(arguments, 1, "rep");
+    int n = check_int(arguments, 2, "rep");
+    Types::String separator = arguments.size() >= 3 && !arguments[2].is<Types::Nil>() ? check_string(arguments, 3, "rep") : Types::String();
+    if (n <= 0) {
+        return result(std::string_view());
+    }
+
+    std::string repeated;
+    repeated.reserve(string.size() * n + separator.size() * (n - 1));
+    for (int i = 0; i < n; ++i) {
+        if (i != 0) {
+            repeated.append(separator.view());
+        }
+        repeated.append(string.view());
+    }
+
+    return result(repeated);
+}
+
+Types::VarList byte(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::String string = check_string(arguments, 1, "byte");
+    int i = opt_int(arguments, 2, "byte", 1);
+    auto [start, end] = range(i, opt_int(arguments, 3, "byte", i), string.size());
+
+    Types::VarList results;
+    for (long position = start; position <= end; ++position) {
+        results.push_back(Types::Var::make(Types::Value::make_int(static_cast<unsigned char>(string.view()[position - 1]))));
+    }
+
+    return results;
+}
+
+Types::VarList char_(Interpreter&, std::span<Types::Value const> arguments) {
+    std::string string;
+    string.reserve(arguments.size());
+    for (size_t i = 1; i <= arguments.size(); ++i) {
+        int c = check_int(arguments, i, "char");
+        if (c < 0 || c > 255) {
+            throw Exceptions::BadArgument(i, "char", "value out of range");
+        }
+        string.push_back(static_cast<char>(c));
+    }
+
+    return result(string);
+}
+
+Types::VarList find(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::String string = check_string(arguments, 1, "find");
+    Types::String pattern = check_string(arguments, 2, "find");
+    long init = std::max(relative(opt_int(arguments, 3, "find", 1), string.size()), 1L);
+    bool plain = arguments.size() >= 4 && arguments[3].as_bool_weak();
+
+    if (init > static_cast<long>(string.size()) + 1) {
+        return result(Types::Value::make_nil());
+    }
+
+    if (!plain && !Patterns::is_plain(pattern.view())) {
+        std::shared_ptr<Patterns::Program const> program = Patterns::compile(pattern);
+        Patterns::Match match;
+        if (!program->find(string.view(), init - 1, match)) {
+            return result(Types::Value::make_nil());
+        }
+
+        Types::VarList results;
+        results.push_back(Types::Var::make(Types::Value::make_int(match._start + 1)));
+        results.push_back(Types::Var::make(Types::Value::make_int(match._end)));
+        if (program->captures() != 0) {
+            push_captures(results, string, *program, match);
+        }
+        return results;
+    }
+
+    size_t position = StringSearch::find(string.view(), pattern.view(), init - 1);
+    if (position == std::string_view::npos) {
+        return result(Types::Value::make_nil());
+    }
+
+    Types::VarList results;
+    results.push_back(Types::Var::make(Types::Value::make_int(position + 1)));
+    results.push_back(Types::Var::make(Types::Value::make_int(position + pattern.size())));
+    return results;
+}
+
+Types::VarList match(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::String string = check_string(arguments, 1, "match");
+    Types::String pattern = check_string(arguments, 2, "match");
+    long init = std::max(relative(opt_int(arguments, 3, "match", 1), string.size()), 1L);
+
+    if (init > static_cast<long>(string.size()) + 1) {
+        return result(Types::Value::make_nil());
+    }
+
+    std::shared_ptr<Patterns::Program const> program = Patterns::compile(pattern);
+    Patterns::Match match;
+    if (!program->find(string.view(), init - 1, match)) {
+        return result(Types::Value::make_nil());
+    }
+
+    Types::VarList results;
+    push_captures(results, string, *program, match);
+    return results;
+}
+
+/* Iterator returned by gmatch. Its state is a table holding the subject, the
+ * pattern, the position from which to search and the end of the last match.
+ * As in Lua 5.4, an empty match at the end of the previous one is skipped,
+ * so that ("abc"):gmatch("%a*") yields "abc" only.
+ */
+Types::VarList gmatch_step(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::Table* state = arguments[0].as<Types::Table*>();
+    Types::String subject = state->dot("subject").as<Types::String>();
+    std::shared_ptr<Patterns::Program const> program = Patterns::compile(state->dot("pattern").as<Types::String>());
+    Types::Value& position = state->dot("position");
+    Types::Value& last = state->dot("last");
+
+    // Anchored patterns can only match at the start of the subject.
+    size_t from = position.as<int>();
+    if (program->anchored() && from != 0) {
+        return result(Types::Value::make_nil());
+    }
+
+    Patterns::Match match;
+    while (program->find(subject.view(), from, match)) {
+        if (static_cast<int>(match._end) == last.as<int>()) {
+            from = match._start + 1;
+            if (program->anchored()) {
+                break;
+            }
+            continue;
+        }
+
+        position = Types::Value::make_int(match._end);
+        last = Types::Value::make_int(match._end);
+
+        Types::VarList results;
+        push_captures(results, subject, *program, match);
+        return results;
+    }
+
+    position = Types::Value::make_int(subject.size() + 1);
+    return result(Types::Value::make_nil());
+}
+
+Types::VarList gmatch(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::String string = check_string(arguments, 1, "gmatch");
+    Types::String pattern = check_string(arguments, 2, "gmatch");
+
+    // Report malformed patterns on the call to gmatch, not on the first
+    // iteration.
+    Patterns::compile(pattern);
+
+    Types::Value state = Types::Value::make_table({});
+    Types::Table* table = state.as<Types::Table*>();
+    table->add_field(Types::String("subject"), Types::Value::make_string(string));
+    table->add_field(Types::String("pattern"), Types::Value::make_string(pattern));
+    table->add_field(Types::String("position"), Types::Value::make_int(0));
+    table->add_field(Types::String("last"), Types::Value::make_int(-1));
+
+    Types::Value iterator;
+    iterator.value() = new Types::Function(&gmatch_step, state);
+    sGC->add_reference(iterator.value());
+    return result(std::move(iterator));
+}
+
+// Append the replacement string of gsub for one match: %0 is the whole
+// match, %1 to %9 the captures and %% a single %.
+void replace_string(std::string& out, std::string_view replacement, std::string_view subject, Patterns::Program const& program, Patterns::Match const& match) {
+    for (size_t i = 0; i < replacement.size(); ++i) {
+        char c = replacement[i];
+        if (c != '%') {
+            out.push_back(c);
+            continue;
+        }
+
+        if (++i == replacement.size()) {
+            throw Exceptions::BadArgument(3, "gsub", "invalid use of '%' in replacement string");
+        }
+
+        c = replacement[i];
+        if (c == '%') {
+            out.push_back('%');
+        } else if (c < '0' || c > '9') {
+            throw Exceptions::BadArgument(3, "gsub", "invalid use of '%' in replacement string");
+        } else if (c == '0' || (c == '1' && program.captures() == 0)) {
+            out.append(subject.substr(match._start, match._end - match._start));
+        } else {
+            size_t index = c - '1';
+            if (index >= program.captures()) {
+                throw Exceptions::BadArgument(3, "gsub", std::string("invalid capture index %") + c + " in replacement string");
+            }
+
+            Patterns::Capture const& capture = match._captures[index];
+            if (capture._length == Patterns::Capture::Position) {
+                out.append(std::to_string(capture._start + 1));
+            } else {
+                out.append(subject.substr(capture._start, capture._length));
+            }
+        }
+    }
+}
+
+// Append the replacement of gsub for one match. A table is indexed with the
+// first capture, a function is called with all of them. If the result is
+// false or nil, the match is kept as is.
+void replace(Interpreter& interpreter, std::string& out, Types::Value const& replacement, Types::String const& subject, Patterns::Program const& program, Patterns::Match const& match) {
+    if (replacement.is<Types::String>() || replacement.is<int>() || replacement.is<double>()) {
+        std::string string = replacement.as_string();
+        replace_string(out, string, subject.view(), program, match);
+        return;
+    }
+
+    Types::VarList captures;
+    push_captures(captures, subject, program, match);
+
+    Types::Value value;
+    if (replacement.is<Types::Table*>()) {
+        value = replacement.as<Types::Table*>()->subscript(captures[0].get());
+    } else {
+        Types::ValueList arguments;
+        for (Types::Var const& capture: captures) {
+            arguments.push_back(capture.get());
+        }
+
+        Types::VarList results = interpreter.call(replacement.as<Types::Function*>(), arguments);
+        if (results.size() != 0) {
+            value = results[0].get();
+        }
+    }
+
+    if (value.is<Types::Nil>() || (value.is<bool>() && !value.as<bool>())) {
+        out.append(subject.view().substr(match._start, match._end - match._start));
+    } else if (value.is<Types::String>() || value.is<int>() || value.is<double>()) {
+        out.append(value.as_string());
+    } else {
+        throw Exceptions::BadArgument(3, "gsub", "invalid replacement value (a " + value.type_as_string() + ")");
+    }
+}
+
+Types::VarList gsub(Interpreter& interpreter, std::span<Types::Value const> arguments) {
+    Types::String string = check_string(arguments, 1, "gsub");
+    Types::String pattern = check_string(arguments, 2, "gsub");
+    if (arguments.size() < 3 || !(arguments[2].is<Types::String>() || arguments[2].is<int>() || arguments[2].is<double>() ||
+                                  arguments[2].is<Types::Table*>() || arguments[2].is<Types::Function*>())) {
+        throw Exceptions::BadArgument(3, "gsub", "string/function/table expected");
+    }
+    Types::Value replacement = arguments[2];
+    long max = opt_int(arguments, 4, "gsub", string.size() + 1);
+
+    // Replacement functions may append to the buffer of a builder string,
+    // which would move the characters of the subject: intern it first.
+    if (replacement.is<Types::Function*>()) {
+        string.hash();
+    }
+
+    std::shared_ptr<Patterns::Program const> program = Patterns::compile(pattern);
+    std::string_view subject = string.view();
+    std::string out;
+    out.reserve(subject.size());
+
+    size_t from = 0;
+    long last = -1;
+    int count = 0;
+    Patterns::Match match;
+    while (count < max && program->find(subject, from, match)) {
+        if (static_cast<long>(match._end) == last) {
+            // Empty match right after the previous one: keep the character
+            // and look further.
+            if (match._start == subject.size() || program->anchored()) {
+                break;
+            }
+            out.push_back(subject[match._start]);
+            from = match._start + 1;
+            continue;
+        }
+
+        out.append(subject.substr(from, match._start - from));
+        replace(interpreter, out, replacement, string, *program, match);
+        ++count;
+        from = last = match._end;
+
+        if (program->anchored()) {
+            break;
+        }
+    }
+    out.append(subject.substr(from));
+
+    Types::VarList results;
+    results.push_back(Types::Var::make(Types::Value::make_string(Types::String(out))));
+    results.push_back(Types::Var::make(Types::Value::make_int(count)));
+    return results;
+}
+
+Types::VarList reverse(Interpreter&, std::span<Types::Value const> arguments) {
+    std::string string(check_string(arguments, 1, "reverse").view());
+    std::reverse(string.begin(), string.end());
+    return result(string);
+}
+
+}
+
+void register_string_library(Interpreter& interpreter) {
+    static const std::pair<char const*, Types::NativeFunction> functions[] = {
+        { "len", &len },
+        { "sub", &sub },
+        { "upper", &upper },
+        { "lower", &lower },
+        { "rep", &rep },
+        { "byte", &byte },
+        { "char", &char_ },
+        { "find", &find },
+        { "match", &match },
+        { "gmatch", &gmatch },
+        { "gsub", &gsub },
+        { "reverse", &reverse }
+    };
+
+    Types::Value library = Types::Value::make_table({});
+    for (auto const& [name, native]: functions) {
+        Types::Value function;
+        function.value() = new Types::Function(native);
+        sGC->add_reference(function.value());
+        library.as<Types::Table*>()->add_field(Types::String(name), function);
+    }
+
+    interpreter.register_global("string", library);
+    interpreter.set_string_methods(library);
+}
+
+}
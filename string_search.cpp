@@ -0,0 +1,183 @@
+#include <cstdint>
+#include <cstring>
+
+#include "string_search.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define STRING_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace StringSearch {
+
+namespace {
+
+constexpr std::size_t npos = std::string_view::npos;
+
+// Whether the bytes of the needle between its first and its last one match
+// the haystack at position i. The first and last ones are already known to
+// match.
+inline bool middle_matches(char const* haystack, std::size_t i, char const* needle, std::size_t size) {
+    return size <= 2 || std::memcmp(haystack + i + 1, needle + 1, size - 2) == 0;
+}
+
+std::size_t find_from(char const* haystack, std::size_t size, char const* needle, std::size_t needle_size, std::size_t i) {
+    for (; i + needle_size <= size; ++i) {
+        if (haystack[i] == needle[0] && haystack[i + needle_size - 1] == needle[needle_size - 1] &&
+            middle_matches(haystack, i, needle, needle_size)) {
+            return i;
+        }
+    }
+
+    return npos;
+}
+
+std::size_t find_byte_from(char const* haystack, std::size_t size, char c, std::size_t i) {
+    for (; i < size; ++i) {
+        if (haystack[i] == c) {
+            return i;
+        }
+    }
+
+    return npos;
+}
+
+#ifdef STRING_SEARCH_X86
+
+/* Substring search: compare a block of candidate positions against the
+ * first and the last byte of the needle at once, and only run memcmp on the
+ * positions where both match. See "SIMD-friendly algorithms for substring
+ * searching", W. Muła.
+ */
+std::size_t find_sse2(char const* haystack, std::size_t size, char const* needle, std::size_t needle_size, std::size_t i) {
+    __m128i const first = _mm_set1_epi8(needle[0]);
+    __m128i const last = _mm_set1_epi8(needle[needle_size - 1]);
+
+    for (; i + needle_size - 1 + 16 <= size; i += 16) {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<__m128i const*>(haystack + i));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<__m128i const*>(haystack + i + needle_size - 1));
+        std::uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+        while (mask) {
+            unsigned int bit = __builtin_ctz(mask);
+            if (middle_matches(haystack, i + bit, needle, needle_size)) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return find_from(haystack, size, needle, needle_size, i);
+}
+
+__attribute__((target("avx2")))
+std::size_t find_avx2(char const* haystack, std::size_t size, char const* needle, std::size_t needle_size, std::size_t i) {
+    __m256i const first = _mm256_set1_epi8(needle[0]);
+    __m256i const last = _mm256_set1_epi8(needle[needle_size - 1]);
+
+    for (; i + needle_size - 1 + 32 <= size; i += 32) {
+        __m256i block_first = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(haystack + i));
+        __m256i block_last = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(haystack + i + needle_size - 1));
+        std::uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+        while (mask) {
+            unsigned int bit = __builtin_ctz(mask);
+            if (middle_matches(haystack, i + bit, needle, needle_size)) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return find_sse2(haystack, size, needle, needle_size, i);
+}
+
+std::size_t find_byte_sse2(char const* haystack, std::size_t size, char c, std::size_t i) {
+    __m128i const pattern = _mm_set1_epi8(c);
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(haystack + i));
+        std::uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(pattern, block));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return find_byte_from(haystack, size, c, i);
+}
+
+__attribute__((target("avx2")))
+std::size_t find_byte_avx2(char const* haystack, std::size_t size, char c, std::size_t i) {
+    __m256i const pattern = _mm256_set1_epi8(c);
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(haystack + i));
+        std::uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(pattern, block));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return find_byte_sse2(haystack, size, c, i);
+}
+
+bool has_avx2() {
+    static bool const avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif
+
+}
+
+std::size_t find(std::string_view haystack, std::string_view needle, std::size_t from) {
+    if (from > haystack.size() || needle.size() > haystack.size() - from) {
+        return npos;
+    } else if (needle.empty()) {
+        return from;
+    } else if (needle.size() == 1) {
+        return find_byte(haystack, needle[0], from);
+    }
+
+#ifdef STRING_SEARCH_X86
+    if (has_avx2()) {
+        return find_avx2(haystack.data(), haystack.size(), needle.data(), needle.size(), from);
+    }
+
+    return find_sse2(haystack.data(), haystack.size(), needle.data(), needle.size(), from);
+#else
+    return find_from(haystack.data(), haystack.size(), needle.data(), needle.size(), from);
+#endif
+}
+
+std::size_t find_byte(std::string_view haystack, char c, std::size_t from) {
+    if (from >= haystack.size()) {
+        return npos;
+    }
+
+#ifdef STRING_SEARCH_X86
+    if (has_avx2()) {
+        return find_byte_avx2(haystack.data(), haystack.size(), c, from);
+    }
+
+    return find_byte_sse2(haystack.data(), haystack.size(), c, from);
+#else
+    return find_byte_from(haystack.data(), haystack.size(), c, from);
+#endif
+}
+
+std::size_t find_scalar(std::string_view haystack, std::string_view needle, std::size_t from) {
+    if (from > haystack.size() || needle.size() > haystack.size() - from) {
+        return npos;
+    } else if (needle.empty()) {
+        return from;
+    }
+
+    return find_from(haystack.data(), haystack.size(), needle.data(), needle.size(), from);
+}
+
+std::size_t find_byte_scalar(std::string_view haystack, char c, std::size_t from) {
+    if (from >= haystack.size()) {
+        return npos;
+    }
+
+    return find_byte_from(haystack.data(), haystack.size(), c, from);
+}
+
+}
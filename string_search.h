@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/* Search kernels of the string library. On x86-64 they process 32 (AVX2,
+ * when the CPU supports it) or 16 (SSE2) bytes per iteration; elsewhere
+ * they fall back to scalar loops. All of them return std::string_view::npos
+ * when nothing is found.
+ */
+namespace StringSearch {
+    // Position of the first occurrence of needle in haystack at or after
+    // from.
+    std::size_t find(std::string_view haystack, std::string_view needle, std::size_t from = 0);
+
+    // Position of the first occurrence of c in haystack at or after from.
+    std::size_t find_byte(std::string_view haystack, char c, std::size_t from = 0);
+
+    // Scalar versions, used on small inputs and as a reference.
+    std::size_t find_scalar(std::string_view haystack, std::string_view needle, std::size_t from = 0);
+    std::size_t find_byte_scalar(std::string_view haystack, char c, std::size_t from = 0);
+}
@@ -0,0 +1,55 @@
+#include "exceptions.h"
+#include "slab_allocator.h"
+#include "sweeper.h"
+#include "types.h"
+
+namespace Types {
+
+std::size_t Sweeper::room() {
+    std::scoped_lock lock(_mutex);
+    return Capacity - _pending;
+}
+
+void Sweeper::hand_off(std::vector<Table*>&& tables) {
+    {
+        std::scoped_lock lock(_mutex);
+        _pending += tables.size();
+        _batches.push_back(std::move(tables));
+        if (!_started) {
+            // The Collector is never destroyed: the thread is never joined.
+            std::thread(&Sweeper::run, this).detach();
+            _started = true;
+        }
+    }
+
+    _work.notify_one();
+}
+
+void Sweeper::wait() {
+    std::unique_lock lock(_mutex);
+    _done.wait(lock, [this] { return _pending == 0; });
+}
+
+void Sweeper::run() {
+    SlabRemoteFrees remote;
+
+    std::unique_lock lock(_mutex);
+    while (true) {
+        _work.wait(lock, [this] { return !_batches.empty(); });
+        std::vector<Table*> batch = std::move(_batches.front());
+        _batches.pop_front();
+
+        lock.unlock();
+        for (Table* table: batch) {
+            delete table;
+        }
+        lock.lock();
+
+        _pending -= batch.size();
+        if (_pending == 0) {
+            _done.notify_all();
+        }
+    }
+}
+
+}
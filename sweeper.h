@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Types {
+    class Table;
+
+    /* Helper thread that deletes the tables the Collector found unreachable,
+     * so that the thread running the interpreter does not pay for freeing
+     * their fields.
+     *
+     * Tables must be stripped before they are handed off (see
+     * Collector::strip): nothing they hold may refer to the reference
+     * counts, strings, shapes or memory accounts, that are not synchronized.
+     * The thread only runs their destructors, and frees their memory; slab
+     * objects are freed under a SlabRemoteFrees.
+     *
+     * At most Capacity tables wait to be deleted at once: the Collector
+     * deletes the ones that do not fit itself.
+     */
+    class Sweeper {
+    public:
+        static constexpr std::size_t Capacity = 1 << 16;
+
+        Sweeper() = default;
+        Sweeper(Sweeper const&) = delete;
+        Sweeper& operator=(Sweeper const&) = delete;
+
+        // Number of tables that can be handed off now.
+        std::size_t room();
+
+        // Delete tables on the helper thread, started the first time.
+        void hand_off(std::vector<Table*>&& tables);
+
+        // Wait until all the tables handed off are deleted.
+        void wait();
+
+    private:
+        void run();
+
+        std::mutex _mutex;
+        std::condition_variable _work;
+        std::condition_variable _done;
+        std::deque<std::vector<Table*>> _batches;
+        // Tables handed off and not deleted yet.
+        std::size_t _pending = 0;
+        bool _started = false;
+    };
+}
@@ -0,0 +1,370 @@
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "builtins.h"
+#include "conversions.h"
+#include "exceptions.h"
+#include "interpreter.h"
+#include "pdqsort.h"
+#include "types.h"
+
+namespace Builtins {
+
+namespace {
+
+// unpack refuses to return more values than this.
+constexpr long MaxUnpack = 1 << 20;
+
+// create refuses to make room for more keys than this, in each part.
+constexpr int MaxCreate = 1 << 26;
+
+Types::VarList result(Types::Value&& value) {
+    Types::VarList results;
+    results.push_back(Types::Var::make(std::move(value)));
+    return results;
+}
+
+// create(narray [, nhash]): empty table with room for the keys 1 to
+// narray, and for nhash other keys.
+Types::VarList create(Interpreter&, std::span<Types::Value const> arguments) {
+    int array = check_int(arguments, 1, "create");
+    int hash = opt_int(arguments, 2, "create", 0);
+    if (array < 0 || array > MaxCreate) {
+        throw Exceptions::BadArgument(1, "create", "out of range");
+    } else if (hash < 0 || hash > MaxCreate) {
+        throw Exceptions::BadArgument(2, "create", "out of range");
+    }
+
+    return result(Types::Value::make_table(array, hash));
+}
+
+Types::VarList insert(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::Table* table = check_table(arguments, 1, "insert");
+    int last = table->border();
+
+    if (arguments.size() == 2) {
+        table->insert(last + 1, last, arguments[1]);
+    } else if (arguments.size() == 3) {
+        int position = check_int(arguments, 2, "insert");
+        if (position < 1 || position > last + 1) {
+            throw Exceptions::BadArgument(2, "insert", "position out of bounds");
+        }
+        table->insert(position, last, arguments[2]);
+    } else {
+        throw Exceptions::BadArgument(arguments.size(), "insert", "wrong number of arguments to 'insert'");
+    }
+
+    return Types::VarList();
+}
+
+Types::VarList remove(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::Table* table = check_table(arguments, 1, "remove");
+    int last = table->border();
+    int position = opt_int(arguments, 2, "remove", last);
+
+    // As in Lua, the position may be one past the end, and 0 if the table
+    // is empty: there is nothing to shift then.
+    if (position != last && (position < 1 || position > last + 1) && !(last == 0 && position == 0)) {
+        throw Exceptions::BadArgument(2, "remove", "position out of bounds");
+    }
+
+    if (position < 1 || position > last) {
+        Types::Value removed = table->get(position);
+        if (!removed.is<Types::Nil>()) {
+            table->set(position, Types::Value::make_nil());
+        }
+        return result(std::move(removed));
+    }
+
+    return result(table->remove(position, last));
+}
+
+// Length of the string value would have in concat, or -1 if it is neither a
+// string nor a number.
+long piece_size(Types::Value const& value) {
+    if (value.is<Types::String>()) {
+        return value.as<Types::String>().size();
+    }
+
+    std::string buffer;
+    if (value.is<int>()) {
+        Conversions::append(buffer, value.as<int>());
+    } else if (value.is<double>()) {
+        Conversions::append(buffer, value.as<double>());
+    } else {
+        return -1;
+    }
+
+    return buffer.size();
+}
+
+void append_piece(std::string& out, Types::Value const& value) {
+    if (value.is<Types::String>()) {
+        out.append(value.as<Types::String>().view());
+    } else if (value.is<int>()) {
+        Conversions::append(out, value.as<int>());
+    } else {
+        Conversions::append(out, value.as<double>());
+    }
+}
+
+/* The size of the result is computed first, so that it is built in a single
+ * allocation, and moved into the String instead of copied.
+ */
+Types::VarList concat(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::Table* table = check_table(arguments, 1, "concat");
+    Types::String separator = arguments.size() >= 2 && !arguments[1].is<Types::Nil>() ? check_string(arguments, 2, "concat") : Types::String();
+    int first = opt_int(arguments, 3, "concat", 1);
+    int last = arguments.size() >= 4 && !arguments[3].is<Types::Nil>() ? check_int(arguments, 4, "concat") : table->border();
+
+    if (first > last) {
+        return result(Types::Value::make_string(Types::String()));
+    }
+
+    std::size_t size = separator.size() * (static_cast<std::size_t>(last) - first);
+    for (long i = first; i <= last; ++i) {
+        long piece = piece_size(table->get(i));
+        if (piece < 0) {
+            throw Exceptions::BadArgument(1, "concat", "invalid value (at index " + std::to_string(i) + ") in table for 'concat'");
+        }
+        size += piece;
+    }
+
+    std::string out;
+    out.reserve(size);
+    for (long i = first; i <= last; ++i) {
+        if (i != first) {
+            out.append(separator.view());
+        }
+        append_piece(out, table->get(i));
+    }
+
+    return result(Types::Value::make_string(Types::String(std::move(out))));
+}
+
+Types::VarList unpack(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::Table* table = check_table(arguments, 1, "unpack");
+    int first = opt_int(arguments, 2, "unpack", 1);
+    int last = arguments.size() >= 3 && !arguments[2].is<Types::Nil>() ? check_int(arguments, 3, "unpack") : table->border();
+
+    Types::VarList results;
+    if (first > last) {
+        return results;
+    }
+
+    long count = static_cast<long>(last) - first + 1;
+    if (count >= MaxUnpack) {
+        throw Exceptions::BadArgument(1, "unpack", "too many results to unpack");
+    }
+
+    results.reserve(count);
+    for (long i = first; i <= last; ++i) {
+        results.push_back(Types::Var::make(Types::Value(table->get(i))));
+    }
+
+    return results;
+}
+
+// move(a1, f, e, t [,a2]): a2[t], ..., a2[t + e - f] = a1[f], ..., a1[e].
+// The ranges may overlap.
+Types::VarList move(Interpreter&, std::span<Types::Value const> arguments) {
+    Types::Table* source = check_table(arguments, 1, "move");
+    int first = check_int(arguments, 2, "move");
+    int last = check_int(arguments, 3, "move");
+    int target = check_int(arguments, 4, "move");
+    Types::Table* destination = arguments.size() >= 5 && !arguments[4].is<Types::Nil>() ? check_table(arguments, 5, "move") : source;
+
+    if (last >= first) {
+        if (first <= 0 && last >= std::numeric_limits<int>::max() + first) {
+            throw Exceptions::BadArgument(3, "move", "too many elements to move");
+        } else if (target > std::numeric_limits<int>::max() - (last - first)) {
+            throw Exceptions::BadArgument(4, "move", "destination wrap around");
+        }
+
+        if (target > last || target <= first || destination != source) {
+            for (int i = 0; i <= last - first; ++i) {
+                destination->set(target + i, source->get(first + i));
+            }
+        } else {
+            for (int i = last - first; i >= 0; --i) {
+                destination->set(target + i, source->get(first + i));
+            }
+        }
+    }
+
+    return result(Types::Value(arguments.size() >= 5 && !arguments[4].is<Types::Nil>() ? arguments[4] : arguments[0]));
+}
+
+/* Without a comparison function, arrays of integers, of numbers and of
+ * strings are sorted on keys extracted once, with the comparison of the
+ * type instead of the generic less than. Integers are exact as doubles, so
+ * numbers of both kinds are compared as doubles.
+ */
+enum class SortKind {
+    INT,
+    NUMBER,
+    STRING
+};
+
+SortKind sort_kind(Types::Table const* table, int size) {
+    bool ints = true;
+    bool numbers = true;
+    bool strings = true;
+    for (int i = 1; i <= size; ++i) {
+        Types::Value const& value = table->get(i);
+        ints = ints && value.is<int>();
+        numbers = numbers && (value.is<int>() || value.is<double>());
+        strings = strings && value.is<Types::String>();
+    }
+
+    if (ints) {
+        return SortKind::INT;
+    } else if (numbers) {
+        return SortKind::NUMBER;
+    } else if (strings) {
+        return SortKind::STRING;
+    }
+
+    // Report the first pair of values that cannot be compared, as the
+    // less than operator would.
+    Types::Value const& first = table->get(1);
+    bool first_number = first.is<int>() || first.is<double>();
+    for (int i = 2; i <= size; ++i) {
+        Types::Value const& value = table->get(i);
+        bool number = value.is<int>() || value.is<double>();
+        if (!(first_number && number) && !(first.is<Types::String>() && value.is<Types::String>())) {
+            throw Exceptions::ContextlessBadTypeException("two numbers or two strings", first.type_as_string() + " and " + value.type_as_string());
+        }
+    }
+
+    throw Exceptions::ContextlessBadTypeException("two numbers or two strings", first.type_as_string() + " and " + first.type_as_string());
+}
+
+void sort_ints(Types::Table* table, int size) {
+    std::vector<int> keys;
+    keys.reserve(size);
+    for (int i = 1; i <= size; ++i) {
+        keys.push_back(table->get(i).as<int>());
+    }
+
+    Sorting::sort(keys.begin(), keys.end(), [](int left, int right) { return left < right; });
+
+    for (int i = 1; i <= size; ++i) {
+        table->set(i, Types::Value::make_int(keys[i - 1]));
+    }
+}
+
+// Sort on a key extracted from each value, then store the values back in
+// the order of their keys.
+template<typename Key, typename Extract>
+void sort_keys(Types::Table* table, int size, Extract extract) {
+    std::vector<Types::Value> values;
+    std::vector<std::pair<Key, Types::Value const*>> keys;
+    values.reserve(size);
+    keys.reserve(size);
+    for (int i = 1; i <= size; ++i) {
+        values.push_back(table->get(i));
+    }
+    for (Types::Value const& value: values) {
+        keys.emplace_back(extract(value), &value);
+    }
+
+    Sorting::sort(keys.begin(), keys.end(), [](auto const& left, auto const& right) { return left.first < right.first; });
+
+    for (int i = 1; i <= size; ++i) {
+        table->set(i, *keys[i - 1].second);
+    }
+}
+
+/* The values are copied out of the table before sorting, so that a
+ * comparison function that modifies the table cannot invalidate them. They
+ * are stored back only once sorted: if the comparison raises an error, the
+ * table is left as it was.
+ */
+Types::VarList sort(Interpreter& interpreter, std::span<Types::Value const> arguments) {
+    Types::Table* table = check_table(arguments, 1, "sort");
+    bool has_comparator = arguments.size() >= 2 && !arguments[1].is<Types::Nil>();
+    if (has_comparator && !arguments[1].is<Types::Function*>()) {
+        throw Exceptions::BadArgument(2, "sort", "function expected, got " + arguments[1].type_as_string());
+    }
+
+    int size = table->border();
+    if (size < 2) {
+        return Types::VarList();
+    }
+
+    if (!has_comparator) {
+        switch (sort_kind(table, size)) {
+        case SortKind::INT:
+            sort_ints(table, size);
+            break;
+
+        case SortKind::NUMBER:
+            sort_keys<double>(table, size, [](Types::Value const& value) {
+                return value.is<int>() ? static_cast<double>(value.as<int>()) : value.as<double>();
+            });
+            break;
+
+        case SortKind::STRING:
+            sort_keys<std::string_view>(table, size, [](Types::Value const& value) {
+                return value.as<Types::String>().view();
+            });
+            break;
+        }
+
+        return Types::VarList();
+    }
+
+    std::vector<Types::Value> values;
+    std::vector<Types::Value const*> order;
+    values.reserve(size);
+    order.reserve(size);
+    for (int i = 1; i <= size; ++i) {
+        values.push_back(table->get(i));
+    }
+    for (Types::Value const& value: values) {
+        order.push_back(&value);
+    }
+
+    {
+        Interpreter::CallFrame frame(interpreter, arguments[1].as<Types::Function*>());
+        Sorting::sort(order.begin(), order.end(), [&frame](Types::Value const* left, Types::Value const* right) {
+            return frame.test(*left, *right);
+        });
+    }
+
+    for (int i = 1; i <= size; ++i) {
+        table->set(i, *order[i - 1]);
+    }
+
+    return Types::VarList();
+}
+
+}
+
+void register_table_library(Interpreter& interpreter) {
+    static const std::pair<char const*, Types::NativeFunction> functions[] = {
+        { "create", &create },
+        { "insert", &insert },
+        { "remove", &remove },
+        { "concat", &concat },
+        { "unpack", &unpack },
+        { "move", &move },
+        { "sort", &sort }
+    };
+
+    Types::Value library = Types::Value::make_table(0, std::size(functions));
+    for (auto const& [name, native]: functions) {
+        Types::Value function;
+        function.value() = new Types::Function(native);
+        sGC->add_reference(function.value());
+        library.as<Types::Table*>()->add_field(Types::String(name), function);
+    }
+
+    interpreter.register_global("table", library);
+}
+
+}
@@ -1,7 +1,9 @@
 #include <algorithm>
+#include <chrono>
 #include <exception>
 #include <filesystem>
 #include <fstream>
+#include <new>
 #include <ranges>
 #include <stdexcept>
 #include <string>
@@ -13,6 +15,7 @@
 #include "LuaLexer.h"
 #include "LuaParser.h"
 
+#include "collector.h"
 #include "exceptions.h"
 #include "interpreter.h"
 
@@ -36,7 +39,21 @@ private:
     std::string _error;
 };
 
-void run_test(std::string const& path) {
+// Write a heap snapshot of interpreter to path, if it is not empty.
+void write_snapshot(Interpreter& interpreter, std::string const& path) {
+    if (path.empty()) {
+        return;
+    }
+
+    std::ofstream stream(path, std::ios::out | std::ios::trunc);
+    if (!stream) {
+        throw std::runtime_error("Unable to open heap snapshot " + path);
+    }
+
+    interpreter.write_heap_snapshot(stream);
+}
+
+void run_test(std::string const& path, std::string const& snapshot = "") {
     std::ifstream stream(path, std::ios::in);
 
     if (!stream) {
@@ -56,6 +73,7 @@ void run_test(std::string const& path) {
     try {
         Interpreter visitor(tree);
         visitor.visit(tree);
+        write_snapshot(visitor, snapshot);
         std::cout << "[OK] " << path << std::endl;
     } catch (std::exception& e) {
         std::ostringstream stream;
@@ -81,6 +99,160 @@ void tests() {
     }
 }
 
+// Parse tree of a chunk given as a string, with the objects it depends on.
+struct Chunk {
+    Chunk(std::string const& source) : _input(source), _lexer(&_input), _tokens(&_lexer), _parser(&_tokens) {
+        _tree = _parser.chunk();
+    }
+
+    antlr4::ANTLRInputStream _input;
+    LuaLexer _lexer;
+    antlr4::CommonTokenStream _tokens;
+    LuaParser _parser;
+    antlr4::tree::ParseTree* _tree;
+};
+
+/* Tables credit the account of the interpreter that created them, even when
+ * they are collected while another interpreter runs.
+ */
+void test_accounts() {
+    constexpr std::size_t tables = static_cast<std::size_t>(Memory::Kind::TABLE);
+
+    // Fewer tables than a minor collection waits for: they are still there
+    // when the first interpreter is done.
+    Chunk garbage("for i = 1, 500 do local t = {} t.self = t t.name = 'garbage' end");
+    Chunk holder("kept = {} collectgarbage() kept.done = true");
+
+    Interpreter first(garbage._tree);
+    first.visit(garbage._tree);
+    std::size_t created = first.memory_stats()._objects[tables];
+
+    Interpreter second(holder._tree);
+    second.visit(holder._tree);
+
+    if (first.memory_stats()._objects[tables] + 500 > created) {
+        throw std::runtime_error("Tables collected while another interpreter ran were not credited to their own");
+    }
+
+    if (second.memory_stats()._objects[tables] == 0) {
+        throw std::runtime_error("Tables of an interpreter were credited to another one");
+    }
+
+    std::cout << "[OK] accounts" << std::endl;
+}
+
+// Value given to keep, by the chunk test_reused_address runs.
+Types::Value* kept_value = nullptr;
+
+Types::VarList keep(Interpreter&, std::span<Types::Value const> arguments) {
+    *kept_value = arguments[0];
+    return { };
+}
+
+/* Objects that outlive their interpreter credit nothing when they are
+ * released, even when another interpreter was built at the same address.
+ */
+void test_reused_address() {
+    Chunk keeping("keep({name = string.rep('x', 1000)})");
+    Chunk other("s = string.rep('y', 5000) t = {s}");
+
+    Types::Value kept;
+    kept_value = &kept;
+
+    alignas(Interpreter) unsigned char storage[sizeof(Interpreter)];
+    Interpreter* first = new (storage) Interpreter(keeping._tree);
+    first->register_global_c_function("keep", new Types::Function(&keep));
+    first->visit(keeping._tree);
+    first->~Interpreter();
+
+    Interpreter* second = new (storage) Interpreter(other._tree);
+    second->visit(other._tree);
+
+    Types::Collector& collector = Types::Collector::instance();
+    collector.request(true);
+    collector.collect();
+    Memory::Stats before = second->memory_stats();
+
+    kept = Types::Value();
+    collector.request(true);
+    collector.collect();
+    Memory::Stats after = second->memory_stats();
+    second->~Interpreter();
+
+    if (after._bytes != before._bytes) {
+        throw std::runtime_error("Objects of a destroyed interpreter were credited to the one built at its address");
+    }
+
+    std::cout << "[OK] reused address" << std::endl;
+}
+
+/* collectgarbage("stop") only stops the interpreter that called it, and
+ * does not keep it from freeing its tables when it is destroyed.
+ */
+void test_stopped_collector() {
+    Chunk stopped("collectgarbage('stop') for i = 1, 2000 do local t = {} t.self = t end");
+    Chunk running("ensure_value_type(collectgarbage('isrunning'), true, 'bool') "
+                  "used = collectgarbage('count') "
+                  "for i = 1, 5000 do local t = {} t.self = t end "
+                  "collectgarbage() "
+                  "ensure_value_type(collectgarbage('count') < used + 100, true, 'bool')");
+
+    std::size_t live = Types::allocation_stats()._tables._live;
+    {
+        Interpreter first(stopped._tree);
+        first.visit(stopped._tree);
+
+        Interpreter second(running._tree);
+        second.visit(running._tree);
+    }
+
+    if (Types::allocation_stats()._tables._live > live) {
+        throw std::runtime_error("Tables of a stopped interpreter outlived it");
+    }
+
+    std::cout << "[OK] stopped collector" << std::endl;
+}
+
+void run_benchmark(std::string const& path, std::string const& snapshot = "") {
+    std::ifstream stream(path, std::ios::in);
+
+    if (!stream) {
+        throw std::runtime_error("Unable to open benchmark " + path);
+    }
+
+    antlr4::ANTLRInputStream input(stream);
+    LuaLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    LuaParser parser(&tokens);
+    if (parser.getNumberOfSyntaxErrors()) {
+        throw std::runtime_error("Errors encountered while processing file " + path + "\n");
+    }
+
+    antlr4::tree::ParseTree* tree = parser.chunk();
+
+    auto start = std::chrono::steady_clock::now();
+    Interpreter visitor(tree);
+    visitor.visit(tree);
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << "[BENCH] " << path << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+    write_snapshot(visitor, snapshot);
+}
+
+void benchmarks() {
+    std::vector<std::string> paths;
+    for (auto& p: fs::directory_iterator("benchmarks")) {
+        if (p.path().extension() == ".lua") {
+            paths.push_back(p.path().string());
+        }
+    }
+
+    std::sort(paths.begin(), paths.end());
+    for (std::string const& path: paths) {
+        run_benchmark(path);
+    }
+}
+
 class GotoBreakResultExpected : public std::exception {
 public:
     GotoBreakResultExpected(const std::string& path, const std::string& expected, const std::string& received) {
@@ -174,6 +346,9 @@ struct CLIArgs {
     bool _base = false;
     bool _goto_break = false;
     std::string _goto_break_file;
+    bool _bench = false;
+    std::string _bench_file;
+    std::string _snapshot_file;
 };
 
 void parse_args(int argc, char** argv, CLIArgs& args) {
@@ -182,7 +357,9 @@ void parse_args(int argc, char** argv, CLIArgs& args) {
             ("help", "Display this help and exit")
             ("test", po::value<std::string>()->implicit_value(""), "Run all tests, or on the given file only")
             ("base", "Run the base file to get the AST")
-            ("gb", po::value<std::string>()->implicit_value(""), "Run tests on the goto_break directory with listener only, or only on the given file");
+            ("gb", po::value<std::string>()->implicit_value(""), "Run tests on the goto_break directory with listener only, or only on the given file")
+            ("bench", po::value<std::string>()->implicit_value(""), "Run and time all benchmarks, or the given file only")
+            ("snapshot", po::value<std::string>(), "Write a heap snapshot to the given file at the end of the test or benchmark file given to --test or --bench");
     po::variables_map vm;
     po::command_line_parser parser(argc, argv);
     parser.options(options);
@@ -207,6 +384,15 @@ void parse_args(int argc, char** argv, CLIArgs& args) {
         args._goto_break = true;
         args._goto_break_file = vm["gb"].as<std::string>();
     }
+
+    if (vm.count("bench")) {
+        args._bench = true;
+        args._bench_file = vm["bench"].as<std::string>();
+    }
+
+    if (vm.count("snapshot")) {
+        args._snapshot_file = vm["snapshot"].as<std::string>();
+    }
 }
 
 int main(int argc, char** argv) {
@@ -249,9 +435,20 @@ int main(int argc, char** argv) {
 
     if (args._test) {
         if (!args._test_file.empty()) {
-            run_test(args._test_file);
+            run_test(args._test_file, args._snapshot_file);
         } else {
             tests();
+            test_accounts();
+            test_reused_address();
+            test_stopped_collector();
+        }
+    }
+
+    if (args._bench) {
+        if (!args._bench_file.empty()) {
+            run_benchmark(args._bench_file, args._snapshot_file);
+        } else {
+            benchmarks();
         }
     }
 
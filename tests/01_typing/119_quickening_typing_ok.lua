@@ -0,0 +1,35 @@
+function add(a, b)
+    return a + b
+end
+
+function mul(a, b)
+    return a * b
+end
+
+function div(a, b)
+    return a / b
+end
+
+-- Site stabilizes on int, then sees doubles and strings
+ensure_value_type(add(1, 2), 3, "int")
+ensure_value_type(add(40, 2), 42, "int")
+ensure_value_type(add(1.5, 2.5), 4.0, "double")
+ensure_value_type(add("1", 2), 3.0, "double")
+ensure_value_type(add(1, 2), 3, "int")
+
+-- Site stabilizes on double, then sees ints
+ensure_value_type(mul(1.5, 2.0), 3.0, "double")
+ensure_value_type(mul(2.0, 2.0), 4.0, "double")
+ensure_value_type(mul(2, 3), 6, "int")
+ensure_value_type(mul(2.0, 3), 6.0, "double")
+
+-- Int specialized division still produces doubles
+ensure_value_type(div(1, 2), 0.5, "double")
+ensure_value_type(div(6, 3), 2.0, "double")
+
+for i = 1, 10 do
+    ensure_value_type(i * 2 - i // 1 % 3, i * 2 - i % 3, "int")
+end
+
+-- add and mul went generic, every other site stayed on ints
+quickening(10, 8, 0, 0, 2)
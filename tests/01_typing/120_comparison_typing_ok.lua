@@ -0,0 +1,34 @@
+ensure_value_type(1 < 2, true, "bool")
+ensure_value_type(2 <= 2.0, true, "bool")
+ensure_value_type(2.5 > 2, true, "bool")
+ensure_value_type(1 >= 1.5, false, "bool")
+
+ensure_value_type(1 == 1.0, true, "bool")
+ensure_value_type(1 ~= 1.0, false, "bool")
+
+-- Strings compare as strings, not as numbers
+ensure_value_type("abc" == "abc", true, "bool")
+ensure_value_type("abc" ~= "abd", true, "bool")
+ensure_value_type("a" < "b", true, "bool")
+ensure_value_type("10" < "9", true, "bool")
+ensure_value_type("b" >= "a", true, "bool")
+
+-- No string to number conversion for equality
+ensure_value_type("1" == 1, false, "bool")
+ensure_value_type(1 ~= "1", true, "bool")
+
+-- References compare by identity
+t = {}
+u = {}
+v = t
+ensure_value_type(t == v, true, "bool")
+ensure_value_type(t == u, false, "bool")
+ensure_value_type(t ~= u, true, "bool")
+
+ensure_value_type(nil == nil, true, "bool")
+ensure_value_type(nil == false, false, "bool")
+ensure_value_type(true == 1, false, "bool")
+
+expect_failure(1 < "2")
+expect_failure(t < u)
+expect_failure(nil <= 1)
@@ -0,0 +1,16 @@
+-- Strings built at runtime are the same strings as literals.
+a = "field"
+b = "fi" .. "eld"
+ensure_value_type(a == b, true, "bool")
+ensure_value_type(a ~= b, false, "bool")
+ensure_value_type(#b, 5, "int")
+
+t = {}
+t.field = 12
+ensure_value_type(t[b], 12, "int")
+t[b] = 13
+ensure_value_type(t.field, 13, "int")
+
+ensure_value_type("abc" < "abd", true, "bool")
+ensure_value_type("b" > "abc", true, "bool")
+ensure_value_type("" == "", true, "bool")
@@ -0,0 +1,36 @@
+-- Concatenation chains and strings built by repeated appends.
+a = "x" .. 1 .. "y" .. 2.5 .. "z"
+ensure_value_type(a, "x1y2.5z", "string")
+
+s = ""
+for i = 1, 100 do
+    s = s .. "ab"
+end
+ensure_value_type(#s, 200, "int")
+
+-- Appending to s does not change the strings built from it before.
+prefix = s
+s = s .. "c"
+ensure_value_type(#prefix, 200, "int")
+ensure_value_type(#s, 201, "int")
+other = prefix .. "d"
+ensure_value_type(#s, 201, "int")
+ensure_value_type(s == prefix .. "c", true, "bool")
+ensure_value_type(other == s, false, "bool")
+
+-- Built strings are regular keys.
+t = {}
+t[s] = 1
+ensure_value_type(t[prefix .. "c"], 1, "int")
+
+twice = s .. s
+ensure_value_type(#twice, 402, "int")
+
+-- Appending a string to itself, while it ends a buffer that has to grow.
+doubled = string.rep("ab", 40) .. "c"
+for i = 1, 6 do
+    doubled = doubled .. doubled
+end
+ensure_value_type(#doubled, 81 * 64, "int")
+ensure_value_type(doubled:sub(-3), "abc", "string")
+ensure_value_type(doubled == string.rep(string.rep("ab", 40) .. "c", 64), true, "bool")
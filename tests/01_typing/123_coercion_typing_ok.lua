@@ -0,0 +1,34 @@
+-- Coercion of numeric strings and number literals.
+ensure_value_type(" 10 " + 1, 11.0, "double")
+ensure_value_type("0x10" + 0, 16.0, "double")
+ensure_value_type("1e2" + 0, 100.0, "double")
+ensure_value_type("-2.5" * 2, -5.0, "double")
+ensure_value_type("5" | 1, 5, "int")
+ensure_value_type("-8" >> 1, -4, "int")
+
+expect_failure("abc" + 1)
+expect_failure("12abc" + 1)
+expect_failure("inf" + 1)
+expect_failure("" + 1)
+expect_failure("2.5" | 1)
+
+ensure_value_type(0x10, 16, "int")
+ensure_value_type(3000000000, 3000000000.0, "double")
+ensure_value_type(2147483647, 2147483647, "int")
+ensure_value_type(1.5e3, 1500.0, "double")
+
+ensure_value_type(1 .. "", "1", "string")
+ensure_value_type(0.5 .. "", "0.5", "string")
+ensure_value_type(1e20 .. "", "1e+20", "string")
+
+-- Numbers out of the range of doubles overflow to inf, or underflow to 0.
+ensure_value_type(1e400 .. "", "inf", "string")
+ensure_value_type(-1e400 .. "", "-inf", "string")
+ensure_value_type(0x1p99999 .. "", "inf", "string")
+ensure_value_type(1e-400, 0.0, "double")
+ensure_value_type(0x1p-99999, 0.0, "double")
+ensure_value_type("1e400" + 0 == 1e400, true, "bool")
+ensure_value_type(" -1e400 " * 1 .. "", "-inf", "string")
+ensure_value_type("1e-400" + 0, 0.0, "double")
+ensure_value_type("0x1p-99999" + 0, 0.0, "double")
+expect_failure("1e400x" + 1)
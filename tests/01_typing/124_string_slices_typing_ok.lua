@@ -0,0 +1,54 @@
+-- Long substrings share the characters of the string they come from.
+row = string.rep("0123456789", 10)
+head = row:sub(1, 40)
+tail = row:sub(-40)
+middle = row:sub(31, 70)
+ensure_value_type(#head, 40, "int")
+ensure_value_type(head == tail, true, "bool")
+ensure_value_type(head == middle, true, "bool")
+ensure_value_type(middle:sub(1, 5), "01234", "string")
+ensure_value_type(middle:sub(11, 50):sub(-3), "789", "string")
+ensure_value_type(row:sub(1), row, "string")
+
+-- Slices are regular keys and values.
+t = {}
+t[head] = "head"
+ensure_value_type(t[tail], "head", "string")
+ensure_value_type(t[string.rep("0123456789", 4)], "head", "string")
+
+-- Concatenating slices copies them.
+joined = head .. "|" .. tail
+ensure_value_type(#joined, 81, "int")
+ensure_value_type(joined:sub(40, 42), "9|0", "string")
+extended = tail .. "x"
+ensure_value_type(#tail, 40, "int")
+ensure_value_type(#extended, 41, "int")
+
+-- Slices of strings built by appends.
+s = ""
+for i = 1, 50 do
+    s = s .. "ab"
+end
+part = s:sub(3, 66)
+s = s .. "c"
+ensure_value_type(#part, 64, "int")
+ensure_value_type(part:sub(-2), "ab", "string")
+ensure_value_type(s:sub(-3), "abc", "string")
+
+-- A short slice outlives the large string it was taken from.
+large = string.rep("abcdefghij", 1000) .. string.rep("klmnopqrst", 5)
+word = large:sub(10001, 10040)
+large = nil
+copy = word
+ensure_value_type(copy, "klmnopqrstklmnopqrstklmnopqrstklmnopqrst", "string")
+ensure_value_type(word == copy, true, "bool")
+
+-- Captures are slices of the subject.
+nl = string.char(10)
+text = string.rep("x", 40) .. nl .. string.rep("y", 40) .. nl .. string.rep("z", 40)
+lines = 0
+for line in text:gmatch("[^" .. nl .. "]+") do
+    lines = lines + 1
+    ensure_value_type(#line, 40, "int")
+end
+ensure_value_type(lines, 3, "int")
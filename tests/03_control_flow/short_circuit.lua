@@ -0,0 +1,54 @@
+calls = 0
+
+function expensive()
+    calls = calls + 1
+    return true
+end
+
+-- Right operand skipped when the left one decides
+a = false and expensive()
+ensure_value_type(a, false, "bool")
+b = nil and expensive()
+ensure_value_type(b, nil, "nil")
+c = 1 or expensive()
+ensure_value_type(c, 1, "int")
+ensure_value_type(calls, 0, "int")
+
+-- Right operand evaluated otherwise
+d = true and expensive()
+ensure_value_type(d, true, "bool")
+e = false or expensive()
+ensure_value_type(e, true, "bool")
+ensure_value_type(calls, 2, "int")
+
+-- Values, not booleans, are returned
+ensure_value_type(1 and 2, 2, "int")
+ensure_value_type(nil or "x", "x", "string")
+ensure_value_type(false or nil, nil, "nil")
+
+-- Conditions
+taken = 0
+if false and expensive() then
+    taken = 1
+end
+ensure_value_type(taken, 0, "int")
+ensure_value_type(calls, 2, "int")
+
+if 1 < 2 or expensive() then
+    taken = 1
+end
+ensure_value_type(taken, 1, "int")
+ensure_value_type(calls, 2, "int")
+
+if not (1 > 2 and expensive()) then
+    taken = 2
+end
+ensure_value_type(taken, 2, "int")
+ensure_value_type(calls, 2, "int")
+
+i = 0
+while i < 3 and (i ~= 10 or expensive()) do
+    i = i + 1
+end
+ensure_value_type(i, 3, "int")
+ensure_value_type(calls, 2, "int")
@@ -0,0 +1,66 @@
+-- Tail calls reuse the frame of the caller: none of these would fit on the
+-- stack otherwise.
+function count(n, acc)
+    if n == 0 then
+        return acc
+    end
+
+    return count(n - 1, acc + 1)
+end
+
+ensure_value_type(count(1000000, 0), 1000000, "int")
+
+function is_even(n)
+    if n == 0 then
+        return true
+    end
+
+    return is_odd(n - 1)
+end
+
+function is_odd(n)
+    if n == 0 then
+        return false
+    end
+
+    return is_even(n - 1)
+end
+
+ensure_value_type(is_even(100001), false, "bool")
+
+-- Method call in tail position
+local counter = { value = 0 }
+counter.step = function(self, n)
+    if n == 0 then
+        return self.value
+    end
+
+    self.value = self.value + 1
+    return self:step(n - 1)
+end
+
+ensure_value_type(counter:step(1000), 1000, "int")
+
+-- The callee is only referenced by the frame being released
+function make_adder(x)
+    local adder = function(y)
+        return x + y
+    end
+
+    return adder(x)
+end
+
+ensure_value_type(make_adder(21), 42, "int")
+
+-- Parenthesized calls are not tail calls and keep only the first result
+function pair()
+    return 1, 2
+end
+
+function first()
+    return (pair())
+end
+
+local a, b = first()
+ensure_value_type(a, 1, "int")
+ensure_value_type(b, nil, "nil")
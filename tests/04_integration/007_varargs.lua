@@ -0,0 +1,126 @@
+-- Extra arguments are shared, not copied, when ... is passed along.
+function count(...)
+    return select('#', ...)
+end
+
+ensure_value_type(count(), 0, "int")
+ensure_value_type(count(1, 2, 3), 3, "int")
+ensure_value_type(count(nil, nil), 2, "int")
+
+function forward(...)
+    return count(...)
+end
+
+ensure_value_type(forward(1, 2, 3, 4), 4, "int")
+
+function second(...)
+    local a = select(2, ...)
+    return a
+end
+
+ensure_value_type(second(10, 20, 30), 20, "int")
+
+function last(...)
+    local a = select(-1, ...)
+    return a
+end
+
+ensure_value_type(last(10, 20, 30), 30, "int")
+
+function rest(x, ...)
+    local a, b, c = ...
+    return b
+end
+
+ensure_value_type(rest(1, 2, 3), 3, "int")
+
+function pass(...)
+    return ...
+end
+
+local a, b, c = pass(1, 2)
+ensure_value_type(a, 1, "int")
+ensure_value_type(b, 2, "int")
+ensure_value_type(c, nil, "nil")
+
+function two()
+    return 1, 2
+end
+
+function three(a, b, c)
+    return c
+end
+
+ensure_value_type(three(two()), nil, "nil")
+ensure_value_type(three(0, two()), 2, "int")
+ensure_value_type(count((pass(1, 2, 3))), 1, "int")
+
+-- Named parameters take their values from a forwarded ..., the extra
+-- arguments after them keep sharing its storage.
+function split(a, b, ...)
+    return b + select('#', ...)
+end
+
+function relay(...)
+    return split(...)
+end
+
+ensure_value_type(relay(1, 2, 3, 4), 4, "int")
+
+function prefix(...)
+    return count(0, ...)
+end
+
+ensure_value_type(prefix(1, 2), 3, "int")
+
+-- Forwarding through many levels passes the same values along.
+function chain(n, ...)
+    if n == 0 then
+        return select('#', ...)
+    end
+    return chain(n - 1, ...)
+end
+
+ensure_value_type(chain(200, 1, 2, 3), 3, "int")
+
+-- select(n, ...) yields the tail of ..., which stands for its first value
+-- in expressions and adjusts like ... in assignments.
+function tail(...)
+    local a, b = select(2, ...)
+    return b
+end
+
+ensure_value_type(tail(1, 2, 3), 3, "int")
+
+function incremented_second(...)
+    return select(2, ...) + 1
+end
+
+ensure_value_type(incremented_second(1, 2, 3), 3, "int")
+
+function tail_count(...)
+    return count(select(2, ...))
+end
+
+ensure_value_type(tail_count(1, 2, 3), 2, "int")
+ensure_value_type(tail_count(1), 0, "int")
+
+function after_ten(...)
+    return select(2, 10, ...)
+end
+
+local x, y = after_ten(1, 2)
+ensure_value_type(x, 1, "int")
+ensure_value_type(y, 2, "int")
+
+-- The selector of select can come from ... too.
+function relay_select(...)
+    return select(...)
+end
+
+ensure_value_type(relay_select("#", 1, 2, 3), 3, "int")
+local p, q = relay_select(2, "a", "b", "c")
+ensure_value_type(p, "b", "string")
+ensure_value_type(q, "c", "string")
+local r = relay_select(-1, "a", "b", "c")
+ensure_value_type(r, "c", "string")
@@ -0,0 +1,52 @@
+s = "Hello, World"
+
+ensure_value_type(string.len(s), 12, "int")
+ensure_value_type(s:len(), 12, "int")
+ensure_value_type(#s, 12, "int")
+
+ensure_value_type(string.sub(s, 1, 5), "Hello", "string")
+ensure_value_type(s:sub(8), "World", "string")
+ensure_value_type(s:sub(-5), "World", "string")
+ensure_value_type(s:sub(-5, -2), "Worl", "string")
+ensure_value_type(s:sub(0), "Hello, World", "string")
+ensure_value_type(s:sub(5, 2), "", "string")
+ensure_value_type(s:sub(10, 100), "rld", "string")
+
+ensure_value_type(s:upper(), "HELLO, WORLD", "string")
+ensure_value_type(s:lower(), "hello, world", "string")
+ensure_value_type(s:reverse(), "dlroW ,olleH", "string")
+
+ensure_value_type(string.rep("ab", 3), "ababab", "string")
+ensure_value_type(string.rep("ab", 3, ","), "ab,ab,ab", "string")
+ensure_value_type(string.rep("ab", 0), "", "string")
+
+ensure_value_type(string.byte("A"), 65, "int")
+ensure_value_type(s:byte(-1), 100, "int")
+local h, e, l = s:byte(1, 3)
+ensure_value_type(h, 72, "int")
+ensure_value_type(e, 101, "int")
+ensure_value_type(l, 108, "int")
+ensure_value_type(string.char(72, 105), "Hi", "string")
+ensure_value_type(string.char(), "", "string")
+
+local first, last = s:find("World")
+ensure_value_type(first, 8, "int")
+ensure_value_type(last, 12, "int")
+ensure_value_type(s:find("o"), 5, "int")
+ensure_value_type(s:find("o", 6), 9, "int")
+ensure_value_type(s:find("o", -4), 9, "int")
+ensure_value_type(s:find("xyz"), nil, "nil")
+ensure_value_type(s:find(".", 1, true), nil, "nil")
+ensure_value_type(s:find(", ", 1, true), 6, "int")
+ensure_value_type(s:find(""), 1, "int")
+ensure_value_type(s:find("", 20), nil, "nil")
+
+-- Long haystacks go through the vectorized kernels.
+long = string.rep("abcdefgh", 100) .. "needle" .. string.rep("xyz", 10)
+ensure_value_type(long:find("needle"), 801, "int")
+ensure_value_type(long:find("z", 1, true), 809, "int")
+ensure_value_type(long:find("needles"), nil, "nil")
+
+-- Numbers are accepted as strings.
+ensure_value_type(string.len(1234), 4, "int")
+ensure_value_type(string.rep(1, 3), "111", "string")
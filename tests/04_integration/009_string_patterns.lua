@@ -0,0 +1,103 @@
+line = "2024-05-17 12:30:45 [ERROR] disk /dev/sda1 is 97% full"
+
+-- match returns the captures, or the whole match if there are none.
+local date, level = line:match("^(%d+%-%d+%-%d+) %S+ %[(%u+)%]")
+ensure_value_type(date, "2024-05-17", "string")
+ensure_value_type(level, "ERROR", "string")
+ensure_value_type(line:match("%d+%%"), "97%", "string")
+ensure_value_type(line:match("/dev/%w+"), "/dev/sda1", "string")
+ensure_value_type(line:match("^%d%d:"), nil, "nil")
+ensure_value_type(string.match("key = value", "(%w+)%s*=%s*(%w+)"), "key", "string")
+ensure_value_type(string.match("hello", "()ll()"), 3, "int")
+ensure_value_type(string.match("hello", "l+", 4), "l", "string")
+ensure_value_type(string.match("  trim  ", "^%s*(.-)%s*$"), "trim", "string")
+ensure_value_type(string.match("abc", "[^%a]"), nil, "nil")
+ensure_value_type(string.match("x = [a-z]", "%[(.-)%]"), "a-z", "string")
+ensure_value_type(string.match("f(a(b)c)d", "%b()"), "(a(b)c)", "string")
+ensure_value_type(string.match("THE (quick) fox", "%f[%a]%a+", 5), "quick", "string")
+ensure_value_type(string.match("say 'hi' now", "(['])(.-)%1"), "'", "string")
+ensure_value_type(string.match("0x1F", "^0[xX](%x+)$"), "1F", "string")
+ensure_value_type(string.match("a-b", "[a%-]+"), "a-", "string")
+ensure_value_type(string.match("]]", "[]]+"), "]]", "string")
+ensure_value_type(string.match("aaa", "a-b"), nil, "nil")
+ensure_value_type(string.match("aaab", "a-b"), "aaab", "string")
+ensure_value_type(string.match("ab", "ab?c?"), "ab", "string")
+
+-- find with patterns returns the bounds, then the captures.
+local first, last, word = line:find("%[(%a+)%]")
+ensure_value_type(first, 21, "int")
+ensure_value_type(last, 27, "int")
+ensure_value_type(word, "ERROR", "string")
+ensure_value_type(line:find("%d+%%"), 47, "int")
+ensure_value_type(line:find("[xyz]"), nil, "nil")
+ensure_value_type(line:find("^2024"), 1, "int")
+ensure_value_type(line:find("^2024", 2), nil, "nil")
+ensure_value_type(line:find("full$"), 51, "int")
+ensure_value_type(string.find("a.b", ".", 1, true), 2, "int")
+ensure_value_type(string.find("abc", ""), 1, "int")
+
+-- gmatch iterates over the matches.
+count = 0
+total = 0
+for number in ("10 20 30 x 40"):gmatch("%d+") do
+    count = count + 1
+    total = total + number
+end
+ensure_value_type(count, 4, "int")
+ensure_value_type(total, 100, "double")
+
+keys = ""
+for k, v in ("a=1, b=2, c=3"):gmatch("(%w+)=(%w+)") do
+    keys = keys .. k .. v
+end
+ensure_value_type(keys, "a1b2c3", "string")
+
+words = ""
+for w in string.gmatch("one two", "%a*") do
+    words = words .. "<" .. w .. ">"
+end
+ensure_value_type(words, "<one><two>", "string")
+
+-- gsub with strings, tables and functions.
+local replaced, n = string.gsub("hello world", "o", "0")
+ensure_value_type(replaced, "hell0 w0rld", "string")
+ensure_value_type(n, 2, "int")
+ensure_value_type(string.gsub("hello world", "(%w+)", "<%1>"), "<hello> <world>", "string")
+ensure_value_type(string.gsub("hello world", "%w+", "%0 %0", 1), "hello hello world", "string")
+ensure_value_type(string.gsub("abc", "", "-"), "-a-b-c-", "string")
+ensure_value_type(string.gsub("hello", "l*", "x"), "xhxexox", "string")
+ensure_value_type(string.gsub("50%", "%%", "%% off"), "50% off", "string")
+ensure_value_type(string.gsub("  x  ", "^%s+", ""), "x  ", "string")
+ensure_value_type(string.gsub("abc", "%w", "%1%1"), "aabbcc", "string")
+
+vars = {name = "Lua", version = 5}
+ensure_value_type(string.gsub("$name $version $missing", "%$(%w+)", vars), "Lua 5 $missing", "string")
+
+function shout(w)
+    return w:upper() .. "!"
+end
+ensure_value_type(string.gsub("hi there", "%a+", shout), "HI! THERE!", "string")
+
+function keep(w)
+    return nil
+end
+ensure_value_type(string.gsub("hi there", "%a+", keep), "hi there", "string")
+
+function sum(a, b)
+    return a + b
+end
+ensure_value_type(string.gsub("1+2 3+4", "(%d)%+(%d)", sum), "3 7", "string")
+
+-- The callback grows the value stack the arguments of gsub were passed on.
+function depth(n, a, b, c, d, e, f, g)
+    if n == 0 then
+        return a
+    end
+    local r = depth(n - 1, a, b, c, d, e, f, g)
+    return r
+end
+
+function deep(w)
+    return depth(100, w:upper(), 2, 3, 4, 5, 6, 7)
+end
+ensure_value_type(string.gsub("one two three", "%a+", deep), "ONE TWO THREE", "string")
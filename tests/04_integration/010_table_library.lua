@@ -0,0 +1,79 @@
+t = {}
+table.insert(t, "a")
+table.insert(t, "c")
+table.insert(t, 2, "b")
+table.insert(t, 1, "z")
+ensure_value_type(#t, 4, "int")
+ensure_value_type(t[1], "z", "string")
+ensure_value_type(t[2], "a", "string")
+ensure_value_type(t[3], "b", "string")
+ensure_value_type(t[4], "c", "string")
+ensure_value_type(table.concat(t), "zabc", "string")
+ensure_value_type(table.concat(t, ", "), "z, a, b, c", "string")
+ensure_value_type(table.concat(t, "-", 2, 3), "a-b", "string")
+ensure_value_type(table.concat(t, "-", 3, 2), "", "string")
+ensure_value_type(table.concat({1, 2.5, "x"}, " "), "1 2.5 x", "string")
+
+ensure_value_type(table.remove(t, 1), "z", "string")
+ensure_value_type(#t, 3, "int")
+ensure_value_type(t[1], "a", "string")
+ensure_value_type(t[3], "c", "string")
+ensure_value_type(t[4], nil, "nil")
+ensure_value_type(table.remove(t), "c", "string")
+ensure_value_type(#t, 2, "int")
+ensure_value_type(table.remove(t, 3), nil, "nil")
+ensure_value_type(table.remove({}), nil, "nil")
+
+-- The array part grows as keys are assigned in order, including keys that
+-- were assigned before the ones preceding them.
+s = {}
+s[3] = 3
+s[2] = 2
+ensure_value_type(#s, 0, "int")
+s[1] = 1
+ensure_value_type(#s, 3, "int")
+s[#s + 1] = 4
+ensure_value_type(#s, 4, "int")
+s[4] = nil
+ensure_value_type(#s, 3, "int")
+
+local a, b, c = table.unpack({10, 20, 30})
+ensure_value_type(a, 10, "int")
+ensure_value_type(b, 20, "int")
+ensure_value_type(c, 30, "int")
+local x, y = table.unpack({10, 20, 30}, 2)
+ensure_value_type(x, 20, "int")
+ensure_value_type(y, 30, "int")
+local first, second = table.unpack({1, 2}, 2, 3)
+ensure_value_type(first, 2, "int")
+ensure_value_type(second, nil, "nil")
+
+m = {1, 2, 3, 4, 5}
+table.move(m, 1, 3, 3)
+ensure_value_type(table.concat(m, ","), "1,2,1,2,3", "string")
+table.move(m, 3, 5, 1)
+ensure_value_type(table.concat(m, ","), "1,2,3,2,3", "string")
+other = table.move(m, 1, 2, 2, {})
+ensure_value_type(other[1], nil, "nil")
+ensure_value_type(other[2], 1, "int")
+ensure_value_type(other[3], 2, "int")
+
+-- Tables in tables keep their references when shifted.
+inner = {}
+outer = {inner}
+table.insert(outer, 1, "head")
+ensure_value_type(outer[2] == inner, true, "bool")
+ensure_value_type(table.remove(outer) == inner, true, "bool")
+ensure_value_type(#outer, 1, "int")
+
+-- Large arrays.
+big = {}
+for i = 1, 1000 do
+    table.insert(big, i)
+end
+for i = 1, 500 do
+    table.remove(big, 1)
+end
+ensure_value_type(#big, 500, "int")
+ensure_value_type(big[1], 501, "int")
+ensure_value_type(big[500], 1000, "int")
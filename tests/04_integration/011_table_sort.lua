@@ -0,0 +1,114 @@
+-- Integers, without a comparison function.
+t = {5, 3, 9, 1, 7, 2, 8, 6, 4}
+table.sort(t)
+ensure_value_type(table.concat(t, " "), "1 2 3 4 5 6 7 8 9", "string")
+
+-- Numbers of both kinds keep their type.
+t = {2.5, 1, 3, 0.5, 2}
+table.sort(t)
+ensure_value_type(t[1], 0.5, "double")
+ensure_value_type(t[2], 1, "int")
+ensure_value_type(t[4], 2.5, "double")
+ensure_value_type(t[5], 3, "int")
+
+t = {"pear", "apple", "fig", "banana", "apricot"}
+table.sort(t)
+ensure_value_type(table.concat(t, " "), "apple apricot banana fig pear", "string")
+
+-- Custom comparison functions.
+t = {5, 3, 9, 1, 7}
+table.sort(t, function(a, b) return a > b end)
+ensure_value_type(table.concat(t, " "), "9 7 5 3 1", "string")
+
+people = {{name = "bob", age = 42}, {name = "alice", age = 31}, {name = "carol", age = 57}}
+table.sort(people, function(a, b) return a.age < b.age end)
+ensure_value_type(people[1].name, "alice", "string")
+ensure_value_type(people[2].name, "bob", "string")
+ensure_value_type(people[3].name, "carol", "string")
+
+-- Comparison functions that are not a single return are called normally.
+comparisons = 0
+function by_name(a, b)
+    comparisons = comparisons + 1
+    return a.name < b.name
+end
+table.sort(people, by_name)
+ensure_value_type(people[1].name, "alice", "string")
+ensure_value_type(people[3].name, "carol", "string")
+ensure_value_type(comparisons > 0, true, "bool")
+
+-- Upvalues of the comparison function.
+weights = {a = 3, b = 1, c = 2}
+t = {"a", "b", "c"}
+table.sort(t, function(x, y) return weights[x] < weights[y] end)
+ensure_value_type(table.concat(t), "bca", "string")
+
+-- Large arrays: random, sorted, reversed and with many duplicates.
+seed = 12345
+function random(n)
+    seed = (seed * 1103515245 + 12345) % 2147483648
+    return seed % n
+end
+
+function is_sorted(t, less)
+    for i = 2, #t do
+        if less(t[i], t[i - 1]) then
+            return false
+        end
+    end
+    return true
+end
+
+function lower(a, b) return a < b end
+
+t = {}
+for i = 1, 5000 do
+    t[i] = random(100000)
+end
+table.sort(t)
+ensure_value_type(#t, 5000, "int")
+ensure_value_type(is_sorted(t, lower), true, "bool")
+
+t = {}
+for i = 1, 5000 do
+    t[i] = i
+end
+table.sort(t, function(a, b) return a > b end)
+ensure_value_type(t[1], 5000, "int")
+ensure_value_type(t[5000], 1, "int")
+table.sort(t)
+ensure_value_type(t[1], 1, "int")
+ensure_value_type(t[5000], 5000, "int")
+
+t = {}
+for i = 1, 5000 do
+    t[i] = random(5)
+end
+table.sort(t)
+ensure_value_type(is_sorted(t, lower), true, "bool")
+
+t = {}
+for i = 1, 2000 do
+    t[i] = "k" .. random(1000)
+end
+table.sort(t, function(a, b) return a < b end)
+ensure_value_type(is_sorted(t, lower), true, "bool")
+
+-- An inconsistent comparison function yields an unspecified order, but
+-- keeps all the values.
+t = {}
+for i = 1, 1000 do
+    t[i] = i
+end
+table.sort(t, function(a, b) return true end)
+ensure_value_type(#t, 1000, "int")
+sum = 0
+for i = 1, #t do
+    sum = sum + t[i]
+end
+ensure_value_type(sum, 500500, "int")
+
+table.sort({})
+table.sort({1})
+expect_failure(table.sort({1, "a", 2}))
+expect_failure(table.sort({{}, {}}))
@@ -0,0 +1,45 @@
+-- The length is found next to the previous one when it moves by one key,
+-- and searched for otherwise.
+t = {}
+for i = 1, 100 do
+    t[#t + 1] = i
+end
+ensure_value_type(#t, 100, "int")
+
+t[#t] = nil
+ensure_value_type(#t, 99, "int")
+t[#t] = nil
+ensure_value_type(#t, 98, "int")
+t[#t + 1] = 99
+ensure_value_type(#t, 99, "int")
+
+i = 99
+while i > 10 do
+    t[i] = nil
+    i = i - 1
+end
+ensure_value_type(#t, 10, "int")
+
+for i = 11, 80 do
+    t[i] = i
+end
+ensure_value_type(#t, 80, "int")
+
+for i = 1, 80 do
+    t[i] = nil
+end
+ensure_value_type(#t, 0, "int")
+t[1] = 1
+ensure_value_type(#t, 1, "int")
+
+-- table.insert and table.remove keep the length up to date.
+s = {}
+for i = 1, 10 do
+    table.insert(s, i)
+end
+ensure_value_type(#s, 10, "int")
+table.remove(s)
+table.remove(s, 1)
+ensure_value_type(#s, 8, "int")
+table.insert(s, 1, 0)
+ensure_value_type(#s, 9, "int")
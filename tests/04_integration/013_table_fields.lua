@@ -0,0 +1,41 @@
+-- String keyed fields, across the growth of the index.
+t = {}
+for i = 1, 200 do
+    t["k" .. i] = i
+end
+ensure_value_type(t.k1, 1, "int")
+ensure_value_type(t.k100, 100, "int")
+ensure_value_type(t.k200, 200, "int")
+ensure_value_type(t.k201, nil, "nil")
+
+for i = 1, 200 do
+    t["k" .. i] = nil
+end
+ensure_value_type(t.k100, nil, "nil")
+t.k100 = "back"
+ensure_value_type(t.k100, "back", "string")
+
+-- The target of an assignment is found before the values are evaluated:
+-- it must survive fields being added to its table meanwhile.
+function fill(r, n)
+    for i = 1, n do
+        r["f" .. i] = i
+    end
+    return n
+end
+
+r = {}
+r.first = fill(r, 100)
+ensure_value_type(r.first, 100, "int")
+ensure_value_type(r.f50, 50, "int")
+
+s = {x = 1}
+s.x, s.y = fill(s, 50), s.x + fill(s, 60)
+ensure_value_type(s.x, 50, "int")
+ensure_value_type(s.y, 61, "int")
+ensure_value_type(s.f60, 60, "int")
+
+-- Keys built at runtime find the fields of keys written in the source.
+p = {name = "point", x = 3}
+ensure_value_type(p["na" .. "me"], "point", "string")
+ensure_value_type(p[string.sub("xyz", 1, 1)], 3, "int")
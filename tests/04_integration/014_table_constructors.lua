@@ -0,0 +1,44 @@
+-- Constructors mixing positional, named and bracketed fields.
+t = {1, 2, x = "x", [10] = 10, nil, 4, ["y"] = "y", [20] = 20}
+ensure_value_type(t[1], 1, "int")
+ensure_value_type(t[2], 2, "int")
+ensure_value_type(t[3], nil, "nil")
+ensure_value_type(t[4], 4, "int")
+ensure_value_type(t[10], 10, "int")
+ensure_value_type(t[20], 20, "int")
+ensure_value_type(t.x, "x", "string")
+ensure_value_type(t.y, "y", "string")
+
+p = {x = 1, y = 2, x = 3}
+ensure_value_type(p.x, 3, "int")
+
+-- Fields are added to the table as they are evaluated.
+n = 0
+function count()
+    n = n + 1
+    return n
+end
+c = {count(), count(), a = count(), count()}
+ensure_value_type(c[1], 1, "int")
+ensure_value_type(c[2], 2, "int")
+ensure_value_type(c[3], 4, "int")
+ensure_value_type(c.a, 3, "int")
+ensure_value_type(#c, 3, "int")
+
+-- table.create only makes room: the table is empty.
+r = table.create(100, 10)
+ensure_value_type(#r, 0, "int")
+ensure_value_type(r[1], nil, "nil")
+for i = 1, 100 do
+    r[i] = i * i
+end
+for i = 1, 10 do
+    r["k" .. i] = i
+end
+ensure_value_type(#r, 100, "int")
+ensure_value_type(r[100], 10000, "int")
+ensure_value_type(r.k10, 10, "int")
+
+e = table.create(0)
+e.z = 1
+ensure_value_type(e.z, 1, "int")
@@ -0,0 +1,54 @@
+-- Tables with the same keys set with the dot syntax share their shape,
+-- whatever the way they are read.
+a = {x = 1, y = 2}
+b = {}
+b.x = 10
+b.y = 20
+c = {}
+c.y = 200
+c.x = 100
+ensure_value_type(a.x + b.x + c.x, 111, "int")
+ensure_value_type(a["y"] + b["y"] + c["y"], 222, "int")
+
+-- Keys set by subscript are found with the dot syntax, and the other way
+-- around.
+k = "z"
+a[k] = 3
+ensure_value_type(a.z, 3, "int")
+a.z = 4
+ensure_value_type(a[k], 4, "int")
+a.w = 5
+ensure_value_type(a["w"], 5, "int")
+
+-- A key set to nil keeps its slot.
+b.x = nil
+ensure_value_type(b.x, nil, "nil")
+ensure_value_type(b.y, 20, "int")
+b.x = 11
+ensure_value_type(b.x, 11, "int")
+
+-- Tables released while others still use their shape, then the same
+-- shapes built again.
+for i = 1, 100 do
+    t = {}
+    t.p = i
+    t.q = i
+    if i % 2 == 0 then
+        t.r = i
+    else
+        t.s = i
+    end
+end
+ensure_value_type(t.p + t.q + t.r, 300, "int")
+ensure_value_type(t.s, nil, "nil")
+
+-- Past the size limit of shapes, keys go to the hash part.
+big = {f1 = 1, f2 = 2, f3 = 3, f4 = 4, f5 = 5, f6 = 6, f7 = 7, f8 = 8, f9 = 9, f10 = 10, f11 = 11, f12 = 12, f13 = 13, f14 = 14, f15 = 15, f16 = 16, f17 = 17, f18 = 18, f19 = 19, f20 = 20, f21 = 21, f22 = 22, f23 = 23, f24 = 24, f25 = 25, f26 = 26, f27 = 27, f28 = 28, f29 = 29, f30 = 30, f31 = 31, f32 = 32, f33 = 33, f34 = 34, f35 = 35, f36 = 36, f37 = 37, f38 = 38, f39 = 39, f40 = 40, f41 = 41, f42 = 42, f43 = 43, f44 = 44, f45 = 45, f46 = 46, f47 = 47, f48 = 48, f49 = 49, f50 = 50, f51 = 51, f52 = 52, f53 = 53, f54 = 54, f55 = 55, f56 = 56, f57 = 57, f58 = 58, f59 = 59, f60 = 60, f61 = 61, f62 = 62, f63 = 63, f64 = 64, f65 = 65, f66 = 66, f67 = 67, f68 = 68, f69 = 69, f70 = 70}
+ensure_value_type(big.f1, 1, "int")
+ensure_value_type(big.f64, 64, "int")
+ensure_value_type(big.f65, 65, "int")
+ensure_value_type(big.f70, 70, "int")
+big.f71 = 71
+ensure_value_type(big["f71"], 71, "int")
+big.f1 = "one"
+ensure_value_type(big.f1, "one", "string")
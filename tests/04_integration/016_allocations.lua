@@ -0,0 +1,65 @@
+-- Tables, functions and the Values they hold are recycled once released:
+-- objects created afterwards reuse their slots. slabs(live, chunks) checks
+-- how much the slabs grew since its last call.
+function make_counter(start)
+    local count = start
+    return function()
+        count = count + 1
+        return count
+    end
+end
+
+total = 0
+function round()
+    for i = 1, 2000 do
+        local t = {i, i + 1, x = i}
+        local counter = make_counter(t.x)
+        counter()
+        total = total + counter() + t[2] - t[1]
+    end
+end
+
+round()
+ensure_value_type(total, 2007000, "int")
+collectgarbage()
+slabs()
+
+-- The same objects a second time fit in the slots of the first ones: the
+-- slabs are back to the same number of objects, without a new chunk.
+round()
+ensure_value_type(total, 4014000, "int")
+collectgarbage()
+slabs(0, 0)
+
+-- Objects kept alive while others are released around them.
+kept = false
+n = 0
+counters = false
+slabs()
+kept = {}
+for i = 1, 3000 do
+    local t = {value = i}
+    if i % 3 == 0 then
+        n = n + 1
+        kept[n] = t
+    end
+end
+ensure_value_type(#kept, 1000, "int")
+ensure_value_type(kept[1].value, 3, "int")
+ensure_value_type(kept[1000].value, 3000, "int")
+
+-- Released slots are handed out again to new objects: once the kept tables,
+-- then the counters, are released, there are no more objects than before.
+kept = nil
+collectgarbage()
+slabs(0)
+
+counters = {}
+for i = 1, 1000 do
+    counters[i] = make_counter(i)
+end
+ensure_value_type(counters[1](), 2, "int")
+ensure_value_type(counters[1000](), 1001, "int")
+counters = nil
+collectgarbage()
+slabs(0)
@@ -0,0 +1,76 @@
+-- Errors raised by a function called through pcall are returned to the
+-- caller, that resumes with its locals intact.
+function divide(a, b)
+    local t = {}
+    return t.missing.field
+end
+
+local before = 42
+ok, message = pcall(divide, 1, 2)
+ensure_value_type(ok, false, "bool")
+ensure_value_type(before, 42, "int")
+
+function add(a, b)
+    return a + b
+end
+
+ok, sum = pcall(add, 1, 2)
+ensure_value_type(ok, true, "bool")
+ensure_value_type(sum, 3, "int")
+
+ok, message = pcall(42)
+ensure_value_type(ok, false, "bool")
+
+-- The memory used by the interpreter grows with the tables it holds.
+used = collectgarbage("count")
+ensure_value_type(collectgarbage(), 0, "int")
+
+function build(n)
+    local rows = {}
+    for i = 1, n do
+        rows[i] = {i, i}
+    end
+    return #rows
+end
+
+build(1000)
+ensure_value_type(collectgarbage("count") > used, true, "bool")
+
+-- Allocations over the limit raise an error that pcall catches, and the
+-- script goes on.
+function fill(n)
+    local t = {}
+    for i = 1, n do
+        t[i] = {i}
+    end
+    return #t
+end
+
+memory_limit(collectgarbage("count") * 1024 + 100000)
+ensure_value_type(fill(100), 100, "int")
+ok, message = pcall(fill, 100000)
+ensure_value_type(ok, false, "bool")
+ensure_value_type(string.find(message, "Not enough memory") ~= nil, true, "bool")
+
+memory_limit(0)
+ensure_value_type(fill(10000), 10000, "int")
+
+-- A field that could not be added leaves the table as it was, whichever
+-- allocation hit the limit.
+function record(t)
+    t.alpha = 1
+    t.beta = 2
+    t.gamma = 3
+    t.delta = 4
+end
+
+for extra = 0, 2000, 8 do
+    local t = {}
+    memory_limit(collectgarbage("count") * 1024 + extra)
+    ok = pcall(record, t)
+    memory_limit(0)
+    ensure_value_type(t.alpha == nil or t.alpha == 1, true, "bool")
+    ensure_value_type(t.delta == nil or t.delta == 4, true, "bool")
+    t.epsilon = 5
+    ensure_value_type(t.epsilon, 5, "int")
+end
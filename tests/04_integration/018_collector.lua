@@ -0,0 +1,68 @@
+-- Tables that are no longer reachable are freed by the collector, even
+-- when they reference each other.
+used = collectgarbage("count")
+for i = 1, 20000 do
+    local t = {i, i, i, i}
+    local u = {t}
+    t[5] = u
+end
+collectgarbage()
+ensure_value_type(collectgarbage("count") < used + 200, true, "bool")
+
+-- Tables that are still reachable survive the collections, and keep their
+-- fields.
+keep = {}
+for i = 1, 5000 do
+    keep[i] = {i * 2}
+end
+for i = 1, 20000 do
+    local t = {i}
+end
+collectgarbage()
+ensure_value_type(#keep, 5000, "int")
+ensure_value_type(keep[4999][1], 9998, "int")
+
+-- Tables held by closures survive too.
+function counter()
+    local state = {count = 0}
+    return function()
+        state.count = state.count + 1
+        return state.count
+    end
+end
+
+next_value = counter()
+for i = 1, 3000 do
+    local t = {i}
+end
+collectgarbage()
+next_value()
+ensure_value_type(next_value(), 2, "int")
+
+-- Young tables used as keys of old ones survive minor collections, even
+-- when they are only reachable from the old table.
+old = {}
+collectgarbage()
+key = {1}
+lost = {2}
+old[key] = 42
+old[lost] = 43
+lost = nil
+for i = 1, 3000 do
+    local t = {i}
+end
+collectgarbage("step")
+ensure_value_type(old[key], 42, "int")
+
+-- Stopped collectors free nothing until they are restarted.
+collectgarbage("stop")
+ensure_value_type(collectgarbage("isrunning"), false, "bool")
+used = collectgarbage("count")
+for i = 1, 5000 do
+    local t = {i}
+end
+ensure_value_type(collectgarbage("count") > used + 100, true, "bool")
+collectgarbage("restart")
+ensure_value_type(collectgarbage("isrunning"), true, "bool")
+collectgarbage()
+ensure_value_type(collectgarbage("count") < used + 100, true, "bool")
@@ -0,0 +1,62 @@
+-- Entries of tables with weak keys disappear once their key is no longer
+-- reachable from elsewhere, even when their value references the key.
+cache = setmetatable({}, {__mode = "k"})
+ensure_value_type(getmetatable(cache).__mode, "k", "string")
+
+kept = {}
+collectgarbage()
+used = collectgarbage("count")
+for i = 1, 5000 do
+    local key = {i}
+    cache[key] = {key, i * 2}
+    if i % 1000 == 0 then
+        kept[#kept + 1] = key
+    end
+end
+collectgarbage()
+ensure_value_type(collectgarbage("count") < used + 100, true, "bool")
+ensure_value_type(cache[kept[3]][2], 6000, "int")
+
+-- Values of tables with weak values are released once they are no longer
+-- reachable from elsewhere.
+objects = setmetatable({}, {__mode = "v"})
+alive = {name = "alive"}
+objects.alive = alive
+objects.dead = {name = "dead"}
+objects[1] = {}
+objects[2] = 2
+collectgarbage()
+ensure_value_type(objects.alive.name, "alive", "string")
+ensure_value_type(objects.dead, nil, "nil")
+ensure_value_type(objects[1], nil, "nil")
+ensure_value_type(objects[2], 2, "int")
+
+-- Functions can be weak keys too.
+memo = setmetatable({}, {__mode = "kv"})
+function make() return function() end end
+f = make()
+memo[f] = 1
+memo[make()] = 2
+collectgarbage()
+ensure_value_type(memo[f], 1, "int")
+
+-- Tables without a weak mode keep their keys alive.
+setmetatable(cache, nil)
+ensure_value_type(getmetatable(cache), nil, "nil")
+used = collectgarbage("count")
+for i = 1, 5000 do
+    cache[{i}] = i
+end
+collectgarbage()
+ensure_value_type(collectgarbage("count") > used + 100, true, "bool")
+
+-- Tables with weak keys can be garbage themselves. Releasing a function
+-- afterwards goes through the remaining tables with weak keys.
+for i = 1, 100 do
+    local dropped = setmetatable({}, {__mode = "k"})
+    dropped[{}] = i
+    dropped[make()] = i
+end
+collectgarbage()
+f = nil
+ensure_value_type(memo[make()], nil, "nil")
@@ -0,0 +1,61 @@
+-- Unreachable tables are handed off to the Sweeper, that deletes them on its
+-- own thread. Their memory is credited when they are handed off, and
+-- allocations(freed, swept) waits until the Sweeper is done. Tables that
+-- reference themselves are left to the collector by the reference counts.
+allocations()
+used = collectgarbage("count")
+
+-- Tables that reference each other.
+for i = 1, 2000 do
+    local t = {i}
+    local u = {t, name = "cycle " .. i}
+    t.next = u
+    t.self = t
+end
+collectgarbage()
+allocations(4000, 4000)
+ensure_value_type(collectgarbage("count") < used + 200, true, "bool")
+
+-- Tables with weak keys or values, with their metatables and entries.
+for i = 1, 1000 do
+    local weak_keys = {__mode = "k"}
+    weak_keys.self = weak_keys
+    local keys = setmetatable({}, weak_keys)
+    keys.self = keys
+    local key = {}
+    key.self = key
+    keys[key] = i
+
+    local weak_values = {__mode = "v"}
+    weak_values.self = weak_values
+    local values = setmetatable({}, weak_values)
+    values.self = values
+    local value = {i}
+    value.self = value
+    values[1] = value
+end
+collectgarbage()
+allocations(6000, 6000)
+ensure_value_type(collectgarbage("count") < used + 200, true, "bool")
+
+-- Tables with a shared metatable and string fields, some of them kept.
+shared = {kind = "shared"}
+kept = {}
+for i = 1, 3000 do
+    local t = setmetatable({name = "object " .. i, label = "label " .. i}, shared)
+    t.self = t
+    if i % 100 == 0 then
+        kept[i // 100] = t
+    end
+end
+collectgarbage()
+allocations(2970, 2970)
+ensure_value_type(#kept, 30, "int")
+ensure_value_type(kept[30].name, "object 3000", "string")
+ensure_value_type(getmetatable(kept[1]).kind, "shared", "string")
+
+kept = nil
+shared = nil
+collectgarbage()
+allocations(30, 30)
+ensure_value_type(collectgarbage("count") < used + 200, true, "bool")
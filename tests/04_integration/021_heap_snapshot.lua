@@ -0,0 +1,21 @@
+-- Written to a heap snapshot and analyzed by tests/heap_snapshot.cmake.
+
+-- A builder string and its prefix, sharing the same buffer.
+prefix = string.rep("x", 100) .. "y"
+extended = prefix .. "z"
+ensure_value_type(#prefix, 101, "int")
+ensure_value_type(#extended, 102, "int")
+
+-- A string and a slice at the start of it.
+row = string.rep("0123456789", 10)
+head = row:sub(1, 40)
+ensure_value_type(#head, 40, "int")
+
+-- Names with line breaks and backslashes, escaped in the snapshot.
+named = {}
+named["first" .. string.char(10) .. "second" .. string.char(13)] = {}
+named["back" .. string.char(92) .. "slash"] = {}
+
+-- A function key released since it was stored.
+keyed = {}
+keyed[function() end] = 1
@@ -0,0 +1,28 @@
+# Run from the source directory by ctest (see CMakeLists.txt). Write a heap
+# snapshot at the end of SCRIPT with TESTER, and check the report of ANALYZER
+# on it: strings that share a buffer are different nodes, and escaped names
+# are read back.
+
+execute_process(COMMAND "${TESTER}" --test "${SCRIPT}" --snapshot "${SNAPSHOT}"
+    RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+if(result)
+    message(FATAL_ERROR "Unable to write the heap snapshot of ${SCRIPT}: ${error}")
+endif()
+
+execute_process(COMMAND "${ANALYZER}" "${SNAPSHOT}" 1000
+    RESULT_VARIABLE result OUTPUT_VARIABLE report ERROR_VARIABLE error)
+if(result)
+    message(FATAL_ERROR "Unable to analyze ${SNAPSHOT}: ${error}")
+endif()
+
+foreach(expected
+        "\t101\tstring\t[^\t]*\t\\(globals\\) -> prefix\n"
+        "\t102\tstring\t[^\t]*\t\\(globals\\) -> extended\n"
+        "\t100\tstring\t[^\t]*\t\\(globals\\) -> row\n"
+        "\t40\tstring\t[^\t]*\t\\(globals\\) -> head\n"
+        "\ttable\ttable\t\\(globals\\) -> named -> \\.first\\\\nsecond\\\\r\n"
+        "\ttable\ttable\t\\(globals\\) -> named -> \\.back\\\\slash\n")
+    if(NOT report MATCHES "${expected}")
+        message(FATAL_ERROR "No match for ${expected} in the report:\n${report}")
+    endif()
+endforeach()
@@ -1,6 +1,15 @@
+#include <algorithm>
 #include <cmath>
-
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "collector.h"
+#include "conversions.h"
 #include "exceptions.h"
+#include "memory.h"
 #include "types.h"
 
 namespace Types {
@@ -23,16 +32,34 @@ bool Nil::operator<(const Nil&) const {
 // ============================================================================
 // Elipsis
 
-Elipsis::Elipsis(std::vector<Types::Value> const& values) : _values(values) { }
+Elipsis::Elipsis() { }
 
-Elipsis::Elipsis(Elipsis const& other) : _values(other._values) {
-    // throw std::runtime_error("Copying elipsis is illegal. I think ?");
+Elipsis::Elipsis(std::span<Types::Value const> values) : _size(values.size()) {
+    if (!values.empty()) {
+        _values = std::make_shared<std::vector<Types::Value> const>(values.begin(), values.end());
+    }
 }
 
-Elipsis& Elipsis::operator=(Elipsis const& other) {
-    _values = other._values;
-    return *this;
-    // throw std::runtime_error("Copying elipsis is illegal. I think ?");
+Elipsis::Elipsis(std::vector<Types::Value>&& values) : _size(values.size()) {
+    if (!values.empty()) {
+        _values = std::make_shared<std::vector<Types::Value> const>(std::move(values));
+    }
+}
+
+Elipsis::Elipsis(Elipsis const& other, size_t offset) {
+    if (offset < other._size) {
+        _values = other._values;
+        _offset = other._offset + offset;
+        _size = other._size - offset;
+    }
+}
+
+std::span<Types::Value const> Elipsis::values() const {
+    if (!_values) {
+        return std::span<Types::Value const>();
+    }
+
+    return std::span<Types::Value const>(_values->data() + _offset, _size);
 }
 
 bool Elipsis::operator==(const Elipsis&) const {
@@ -50,22 +77,50 @@ bool Elipsis::operator<(const Elipsis&) const {
 // ============================================================================
 // Function
 
-Function::Function(std::vector<std::string>&& formal_parameters, LuaParser::BlockContext* body) {
+Function::Function(std::vector<std::string>&& formal_parameters, LuaParser::BlockContext* body) : _account(Memory::Account::current_id()) {
     _function = PureLuaFunction();
     pure()._body = body;
     pure()._formal_parameters = std::move(formal_parameters);
 }
 
-Function::Function(FunctionAbstractionBuilderAbstraction *builder) {
+Function::Function(FunctionAbstractionBuilderAbstraction *builder) : _account(Memory::Account::current_id()) {
     _function = CLuaFunction();
     c()._builder = builder;
 }
 
+Function::Function(NativeFunction function) : _account(Memory::Account::current_id()) {
+    _function = NativeLuaFunction { function };
+}
+
+Function::Function(NativeFunction function, Value const& state) : _account(Memory::Account::current_id()) {
+    _function = NativeLuaFunction { function, new Value(state) };
+}
+
+Function::Function(NativeFunction function, NativeVarargFunction vararg) : _account(Memory::Account::current_id()) {
+    _function = NativeLuaFunction { function, nullptr, vararg };
+}
+
 Function::~Function() {
+    Collector::instance().erase_key(this);
+
     if (std::holds_alternative<PureLuaFunction>(_function)) {
         for (Value* v: std::views::values(pure()._closure)) {
             v->remove_reference();
         }
+    } else if (NativeLuaFunction* native = std::get_if<NativeLuaFunction>(&_function)) {
+        delete native->_state;
+    }
+}
+
+void* Function::operator new(std::size_t) {
+    Memory::charge(Memory::Kind::FUNCTION, sizeof(Function));
+    return SlabAllocator<Function>::instance().allocate();
+}
+
+void Function::operator delete(void* ptr, std::size_t) {
+    if (ptr) {
+        SlabAllocator<Function>::instance().deallocate(ptr);
+        Memory::credit(Memory::Kind::FUNCTION, sizeof(Function));
     }
 }
 
@@ -116,12 +171,55 @@ bool Userdata::operator!=(const Userdata& other) const {
 // ============================================================================
 // Table
 
-Table::Table(const std::list<std::pair<Value, Value>> &values)  : _bool_fields(2) {
+Table::Table(const std::list<std::pair<Value, Value>> &values)  : _bool_fields(2), _shape(Shape::root()), _account(Memory::Account::current_id()) {
     for (auto const& p: values) {
         std::visit(FieldSetter(*this, p.second), p.first._type);
     }
 }
 
+Table::Table(std::size_t array, std::size_t hash) : _bool_fields(2), _shape(Shape::root()), _account(Memory::Account::current_id()) {
+    reserve(array, hash);
+}
+
+Table::~Table() {
+    // Stripped tables were untracked before being handed to the Sweeper:
+    // this may be its thread, which must not touch the Collector.
+    if (_shape) {
+        Collector::instance().untrack(this);
+    }
+
+    for (Value* value: _array) {
+        delete value;
+    }
+
+    for (Value* value: std::views::values(_int_fields)) {
+        delete value;
+    }
+
+    for (Value* value: _fields) {
+        delete value;
+    }
+
+    delete _metatable;
+
+    // Collector::strip released it already.
+    if (_shape) {
+        _shape->release();
+    }
+}
+
+void* Table::operator new(std::size_t) {
+    Memory::charge(Memory::Kind::TABLE, sizeof(Table));
+    return SlabAllocator<Table>::instance().allocate();
+}
+
+void Table::operator delete(void* ptr, std::size_t) {
+    if (ptr) {
+        SlabAllocator<Table>::instance().deallocate(ptr);
+        Memory::credit(Memory::Kind::TABLE, sizeof(Table));
+    }
+}
+
 bool Table::operator==(const Table& other) const {
     return this == &other;
 }
@@ -130,54 +228,205 @@ bool Table::operator!=(const Table& other) const {
     return this != &other;
 }
 
+/* Writes go through the Value& returned by subscript, so the table does not
+ * see the values it stores: the last border found is kept as a hint, and
+ * checked against the array part. Appending (t[#t + 1] = v) and popping
+ * (t[#t] = nil) move the border by one key, which is found next to the
+ * hint in constant time. Only when it moved further is it searched for.
+ */
 int Table::border() const {
-    std::set<unsigned int> keys;
-    for (int v : std::views::keys(_int_fields) |
-         std::views::filter([](int i) {
-            return i > 0;
-        })) {
+    std::size_t size = _array.size();
+    if (size == 0 || !_array[size - 1]->is<Nil>()) {
+        // The key after the array part is never in _int_fields.
+        _border = size;
+        return size;
+    }
 
-        keys.insert(v);
+    // The value of size is nil, so the border is below it. Keys count from
+    // 1: the border b is such that b is 0 or not nil, and b + 1 is nil.
+    std::size_t hint = std::min(_border, size - 1);
+    auto is_border = [this](std::size_t b) {
+        return (b == 0 || !_array[b - 1]->is<Nil>()) && _array[b]->is<Nil>();
+    };
+
+    if (is_border(hint)) {
+        return hint;
+    } else if (hint + 1 < size && is_border(hint + 1)) {
+        _border = hint + 1;
+        return _border;
+    } else if (hint > 0 && is_border(hint - 1)) {
+        _border = hint - 1;
+        return _border;
     }
 
-    for (auto iter = keys.begin(); iter != keys.end(); ++iter) {
-        auto next = iter;
-        std::advance(next, 1);
+    // Binary search of a non nil value followed by nil, on the side of the
+    // hint where there is one. i is 0 or not nil, j is nil.
+    std::size_t i = 0;
+    std::size_t j = size;
+    if (_array[hint]->is<Nil>()) {
+        j = hint + 1;
+    } else {
+        i = hint + 1;
+    }
 
-        if (next != keys.end()) {
-            if (*iter == *next - 1) {
-                continue;
-            } else {
-                return *iter;
-            }
+    while (j - i > 1) {
+        std::size_t middle = (i + j) / 2;
+        if (_array[middle - 1]->is<Nil>()) {
+            j = middle;
         } else {
-            return *iter;
+            i = middle;
         }
     }
 
-    return 0;
+    _border = i;
+    return i;
+}
+
+// Fields that fit in the shape are expected to be set with the dot syntax.
+void Table::reserve(std::size_t array, std::size_t hash) {
+    _array.reserve(array);
+    if (hash <= MaxShapeSize) {
+        _fields.reserve(hash);
+    } else {
+        _string_fields.reserve(hash);
+    }
+}
+
+Value const& Table::get(int i) const {
+    if (i >= 1 && static_cast<std::size_t>(i) <= _array.size()) {
+        return *_array[i - 1];
+    }
+
+    auto iter = _int_fields.find(i);
+    return iter != _int_fields.end() ? *iter->second : Value::_nil;
+}
+
+void Table::set(int i, Value const& value) {
+    assign(int_field(i, true), value);
+}
+
+void Table::insert(int position, int last, Value const& value) {
+    if (static_cast<std::size_t>(last) == _array.size()) {
+        append();
+    }
+
+    // The value of the key last + 1 is nil: reuse it for position.
+    Value** slots = _array.data();
+    Value* slot = slots[last];
+    std::memmove(slots + position, slots + position - 1, (last - position + 1) * sizeof(Value*));
+    slots[position - 1] = slot;
+    assign(*slot, value);
+    _border = last + 1;
+}
+
+Value Table::remove(int position, int last) {
+    Value** slots = _array.data();
+    Value* slot = slots[position - 1];
+    Value result(*slot);
+    std::memmove(slots + position - 1, slots + position, (last - position) * sizeof(Value*));
+    slots[last - 1] = slot;
+    assign(*slot, Value());
+    _border = last - 1;
+    return result;
+}
+
+Value& Table::append() {
+    Value* value = new Value();
+    _array.push_back(value);
+
+    // Move the keys that now follow the array part from _int_fields.
+    for (auto iter = _int_fields.find(_array.size() + 1); iter != _int_fields.end() && static_cast<std::size_t>(iter->first) == _array.size() + 1;
+         iter = _int_fields.erase(iter)) {
+        _array.push_back(iter->second);
+    }
+
+    return *value;
+}
+
+Value& Table::int_field(int i, bool set_nil) {
+    if (i >= 1 && static_cast<std::size_t>(i) <= _array.size()) {
+        return *_array[i - 1];
+    } else if (set_nil && static_cast<std::size_t>(i) == _array.size() + 1) {
+        return append();
+    }
+
+    auto iter = _int_fields.find(i);
+    if (iter != _int_fields.end()) {
+        return *iter->second;
+    } else if (set_nil) {
+        Value* value = new Value();
+        _int_fields.emplace(i, value);
+        return *value;
+    }
+
+    return Value::_nil;
+}
+
+void Table::assign(Value& slot, Value const& value) {
+    sGC->remove_reference(slot.value());
+    slot.value() = value.value();
+    sGC->add_reference(slot.value());
 }
 
 Value& Table::subscript(Value const& value, bool set_nil) {
     return std::visit(Table::FieldGetter(*this, set_nil), value._type);
 }
 
-Value& Table::dot(const std::string &name, bool set_nil) {
-    auto iter = _string_fields.find(name);
-    if (iter != _string_fields.end()) {
-        return iter->second;
-    } else {
-        if (set_nil) {
-            _string_fields[name] = Types::Value::_nil;
-            return _string_fields[name];
-        } else {
-            return Value::_nil;
+Value const& Table::metatable() const {
+    return _metatable ? *_metatable : Value::_nil;
+}
+
+void Table::set_metatable(Value const& metatable) {
+    // Allocated first, so that the table is unchanged if it raises.
+    Value* replacement = metatable.is<Table*>() ? new Value(metatable) : nullptr;
+    delete _metatable;
+    _metatable = replacement;
+
+    std::string_view mode;
+    if (_metatable) {
+        if (Value const& field = metatable.as<Table*>()->dot(String("__mode")); field.is<String>()) {
+            mode = field.as<String>().view();
         }
     }
+
+    _weak_keys = mode.find('k') != std::string_view::npos;
+    _weak_values = mode.find('v') != std::string_view::npos;
+    Collector::instance().set_weak_keys(this, _weak_keys);
 }
 
-void Table::add_field(const std::string &name, const Value &value) {
-    _string_fields[name] = value;
+Value& Table::dot(String const& name, bool set_nil) {
+    return string_field(name, set_nil, true);
+}
+
+Value& Table::string_field(String const& key, bool set_nil, bool record) {
+    if (long slot = _shape->find(key); slot >= 0) {
+        return *_fields[slot];
+    } else if (Value* value = _string_fields.find(key)) {
+        return *value;
+    } else if (!set_nil) {
+        return Value::_nil;
+    }
+
+    if (record && _shape->size() < MaxShapeSize) {
+        // Allocate before moving to the next shape, that must not have a key
+        // without a slot: Exceptions::MemoryLimit can be caught by pcall.
+        std::unique_ptr<Value> value(new Value());
+        if (_fields.size() == _fields.capacity()) {
+            _fields.reserve(std::max<std::size_t>(2 * _fields.capacity(), 4));
+        }
+
+        Shape* shape = _shape->add(key);
+        _shape->release();
+        _shape = shape;
+        _fields.push_back(value.release());
+        return *_fields.back();
+    }
+
+    return _string_fields.insert(key);
+}
+
+void Table::add_field(String const& name, const Value &value) {
+    dot(name, true) = value;
 }
 
 void Table::add_field(const Value &source, const Value &dst) {
@@ -190,7 +439,7 @@ void Table::add_field(const Value &source, const Value &dst) {
 Table::FieldSetter::FieldSetter(Table& t, Value const& value) : _value(value), _t(t) { }
 
 void Table::FieldSetter::operator()(int i) {
-    _t._int_fields[i] = _value;
+    _t.int_field(i, true) = _value;
 }
 
 void Table::FieldSetter::operator()(double d) {
@@ -201,8 +450,8 @@ void Table::FieldSetter::operator()(bool b) {
     _t._bool_fields[b ? 1 : 0] = _value;
 }
 
-void Table::FieldSetter::operator()(std::string const& s) {
-    _t._string_fields[s] = _value;
+void Table::FieldSetter::operator()(String const& s) {
+    _t.string_field(s, true, false) = _value;
 }
 
 void Table::FieldSetter::operator()(Function* f) {
@@ -210,6 +459,7 @@ void Table::FieldSetter::operator()(Function* f) {
 }
 
 void Table::FieldSetter::operator()(Table* t) {
+    Collector::instance().store_key(&_t, t);
     _t._table_fields[t] = _value;
 }
 
@@ -223,16 +473,7 @@ void Table::FieldSetter::operator()(Userdata* u) {
 Table::FieldGetter::FieldGetter(Table& t, bool set_nil) : _t(t), _set_nil(set_nil) { }
 
 Value& Table::FieldGetter::operator()(int i) {
-    if (_t._int_fields.find(i) == _t._int_fields.end()) {
-        if (_set_nil) {
-            _t._int_fields[i] = Value::_nil;
-            return _t._int_fields[i];
-        } else {
-            return Value::_nil;
-        }
-    } else {
-        return _t._int_fields[i];
-    }
+    return _t.int_field(i, _set_nil);
 }
 
 Value& Table::FieldGetter::operator()(double d) {
@@ -254,17 +495,8 @@ Value& Table::FieldGetter::operator()(bool b) {
     return _t._bool_fields[b];
 }
 
-Value& Table::FieldGetter::operator()(std::string const& s) {
-    if (_t._string_fields.find(s) == _t._string_fields.end()) {
-        if (_set_nil) {
-            _t._string_fields[s] = Value::_nil;
-            return _t._string_fields[s];
-        } else {
-            return Value::_nil;
-        }
-    } else {
-        return _t._string_fields[s];
-    }
+Value& Table::FieldGetter::operator()(String const& s) {
+    return _t.string_field(s, _set_nil, false);
 }
 
 Value& Table::FieldGetter::operator()(Function* f) {
@@ -283,6 +515,7 @@ Value& Table::FieldGetter::operator()(Function* f) {
 Value& Table::FieldGetter::operator()(Table* t) {
     if (_t._table_fields.find(t) == _t._table_fields.end()) {
         if (_set_nil) {
+            Collector::instance().store_key(&_t, t);
             _t._table_fields[t] = Value::_nil;
             return _t._table_fields[t];
         } else {
@@ -333,15 +566,49 @@ constexpr bool Value::is_refcounted() const {
     return std::visit(IsReferenceChecker(), _type);
 }
 
+void* Value::operator new(std::size_t size) {
+    if (size != sizeof(Value)) {
+        return ::operator new(size);
+    }
+
+    Memory::charge(Memory::Kind::VALUE, sizeof(Value));
+    return SlabAllocator<Value>::instance().allocate();
+}
+
+void Value::operator delete(void* ptr, std::size_t size) {
+    if (!ptr) {
+        return;
+    }
+
+    if (size != sizeof(Value)) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    SlabAllocator<Value>::instance().deallocate(ptr);
+    Memory::credit(Memory::Kind::VALUE, sizeof(Value));
+}
+
 Value& Value::operator=(const Value& other) {
     if (this == &Value::_nil || this == &Value::_false || this == &Value::_true) {
         throw std::runtime_error("Cannot change nil, false or true");
     }
+
+    Table* const* previous = std::get_if<Table*>(&_type);
+    LuaValue previous_table = previous ? LuaValue(*previous) : LuaValue(Nil());
+
     _type = other._type;
     if (is_refcounted()) {
         sGC->add_reference(_type);
     }
 
+    // Only the reference to a table is released: tables keep the one
+    // make_table added until the Collector frees them, so this never deletes
+    // a table while pointers to its fields are held.
+    if (previous) {
+        sGC->remove_reference(previous_table);
+    }
+
     return *this;
 }
 
@@ -372,8 +639,8 @@ bool Value::operator==(const Value& other) const {
             return as<int>() == other.as<int>();
         } else if (is<bool>()) {
             return as<bool>() == other.as<bool>();
-        } else if (is<std::string>()) {
-            return as<std::string>() == other.as<std::string>();
+        } else if (is<String>()) {
+            return as<String>() == other.as<String>();
         } else if (is<Nil>() || is<Elipsis>()) {
             return true;
         } else if (is<Table*>()) {
@@ -415,16 +682,12 @@ constexpr bool Value::has_dot() const {
 }
 
 std::string Value::as_string() const {
-    if (is<std::string>()) {
-        return as<std::string>();
+    if (is<String>()) {
+        return as<String>().str();
     } else if (is<int>()) {
-        std::ostringstream stream;
-        stream << as<int>();
-        return stream.str();
+        return Conversions::to_string(as<int>());
     } else if (is<double>()) {
-        std::ostringstream stream;
-        stream << as<double>();
-        return stream.str();
+        return Conversions::to_string(as<double>());
     } else if (is<Nil>()) {
         return "nil";
     } else {
@@ -447,18 +710,23 @@ int Value::as_int_weak(bool allow_double) const {
             // Conversion from double to int is not allowed to fail
             throw Exceptions::ContextlessBadTypeException("integer", "double");
         }
-    } else if (is<std::string>()) {
-        try {
-            double d = std::stod(as<std::string>());
-            double intpart;
-            if (std::modf(d, &intpart) == 0.0) {
-                return d;
-            } else {
-                throw Exceptions::ContextlessBadTypeException("weak integer", "string of double");
-            }
-        } catch (std::invalid_argument& e) {
-            return std::stoi(as<std::string>());
+    } else if (is<String>()) {
+        std::string_view string = as<String>().view();
+        if (std::optional<int> i = Conversions::to_int(string)) {
+            return *i;
         }
+
+        std::optional<double> d = Conversions::to_double(string);
+        if (!d) {
+            throw Exceptions::ContextlessBadTypeException("weak integer", "non-numeric string");
+        }
+
+        double intpart;
+        if (std::modf(*d, &intpart) != 0.0 || *d < std::numeric_limits<int>::min() || *d > std::numeric_limits<int>::max()) {
+            throw Exceptions::ContextlessBadTypeException("weak integer", "string of double");
+        }
+
+        return *d;
     } else {
         throw Exceptions::ContextlessBadTypeException("weak integer", type_as_string());
     }
@@ -469,8 +737,12 @@ double Value::as_double_weak() const {
         return as<double>();
     } else if (is<int>()) {
         return as<int>();
-    } else if (is<std::string>()) {
-        return std::stod(as<std::string>());
+    } else if (is<String>()) {
+        if (std::optional<double> d = Conversions::to_double(as<String>().view())) {
+            return *d;
+        }
+
+        throw Exceptions::ContextlessBadTypeException("weak double", "non-numeric string");
     } else {
         throw Exceptions::ContextlessBadTypeException("weak double", type_as_string());
     }
@@ -490,22 +762,16 @@ bool Value::as_bool_weak() const {
 // Lua 5.3.2 interpreter, I've decided to yield the appropriate type
 // instead.
 Value Value::from_string_to_number(bool force_double) const {
-    if (!is<std::string>()) {
+    if (!is<String>()) {
         throw Exceptions::ContextlessBadTypeException("string", type_as_string());
     }
 
     Value v;
-    if (force_double) {
+    std::optional<int> i;
+    if (!force_double && (i = Conversions::to_int(as<String>().view()))) {
+        v._type = *i;
+    } else {
         v._type = as_double_weak();
-        return v;
-    } else {
-        try {
-            v._type = as_int_weak();
-        } catch (std::invalid_argument& e) {
-            v._type = as_double_weak();
-        } catch (std::out_of_range& e) {
-            throw;
-        }
     }
 
     return v;
@@ -528,16 +794,27 @@ Value Value::make_true() { return _true; }
 
 Value Value::make_false() { return _false; }
 
+// Tables hold one reference more than the Values that reference them, so
+// that reference counting never frees them: the Collector does.
 Value Value::make_table(std::list<std::pair<Value, Value>> const& values) {
     Value v;
     alloc<Table>(v, values);
     sGC->add_reference(v._type);
+    Collector::instance().track(v.as<Table*>());
     return v;
 }
 
-Value Value::make_string(std::string&& string) {
+Value Value::make_table(std::size_t array, std::size_t hash) {
     Value v;
-    v._type = std::move(string);
+    alloc<Table>(v, array, hash);
+    sGC->add_reference(v._type);
+    Collector::instance().track(v.as<Table*>());
+    return v;
+}
+
+Value Value::make_string(String const& string) {
+    Value v;
+    v._type = string;
     return v;
 }
 
@@ -560,7 +837,7 @@ std::string Value::type_as_string() const {
         return "double";
     } else if (is<int>()) {
         return "int";
-    } else if (is<std::string>()) {
+    } else if (is<String>()) {
         return "string";
     } else if (is<Function*>()) {
         return "function";
@@ -580,11 +857,11 @@ std::string Value::value_as_string() const {
     if (is<Nil>()) {
         result << "nil";
     } else if (is<double>()) {
-        result << as<double>();
+        result << Conversions::to_string(as<double>());
     } else if (is<int>()) {
         result << as<int>();
-    } else if (is<std::string>()) {
-        result << as<std::string>();
+    } else if (is<String>()) {
+        result << as<String>().str();
     } else if (is<Function*>()) {
         result << "function: " << as<Function*>();
     } else if (is<Userdata*>()) {
@@ -610,7 +887,7 @@ Value& Value::subscript(Value const& value) {
     }
 }
 
-Value& Value::dot(std::string const& name) {
+Value& Value::dot(String const& name) {
     if (is<Table*>()) {
         return as<Table*>()->dot(name);
     } else if (is<Userdata*>()) {
@@ -651,12 +928,27 @@ GC* GC::instance() {
     return &instance;
 }
 
+// Only reference types are tracked, otherwise every number or string that
+// transits through a variable would stay in the map forever.
 void GC::add_reference(LuaValue const& l) {
+    if (!std::visit(IsReferenceChecker(), l)) {
+        return;
+    }
+
     _references[l]++;
 }
 
+unsigned int GC::references(LuaValue const& l) const {
+    auto iter = _references.find(l);
+    return iter != _references.end() ? iter->second : 0;
+}
+
+void GC::forget(LuaValue const& l) {
+    _references.erase(l);
+}
+
 void GC::remove_reference(LuaValue& l) {
-    if (_references.find(l) == _references.end()) {
+    if (!std::visit(IsReferenceChecker(), l) || _references.find(l) == _references.end()) {
         return;
     }
 
@@ -672,19 +964,37 @@ void GC::remove_reference(LuaValue& l) {
     }
 }
 
+// The function, and the Values it closes over, are credited to its account.
+void GC::Deleter::operator()(Function* function) {
+    Memory::Account::Scope scope(function->account());
+    delete function;
+}
+
+AllocationStats allocation_stats() {
+    Collector::instance().finish_sweeping();
+    SlabAllocator<Value>::instance().reclaim();
+    SlabAllocator<Table>::instance().reclaim();
+    SlabAllocator<Function>::instance().reclaim();
+
+    AllocationStats stats;
+    stats._values = SlabAllocator<Value>::instance().stats();
+    stats._tables = SlabAllocator<Table>::instance().stats();
+    stats._functions = SlabAllocator<Function>::instance().stats();
+    return stats;
+}
+
+void release_unused_memory() {
+    Collector::instance().finish_sweeping();
+    SlabAllocator<Value>::instance().release_unused();
+    SlabAllocator<Table>::instance().release_unused();
+    SlabAllocator<Function>::instance().release_unused();
+}
+
 // ============================================================================
 // Var
 
 Value Var::get() const {
-    if (lvalue()) {
-        return *_lvalue();
-    } else if (rvalue()) {
-        return _rvalue();
-    } else if (list()) {
-        return _list()[0];
-    } else {
-        _error();
-    }
+    return peek();
 }
 
 
@@ -860,7 +1170,7 @@ Value& Var::subscript(Value const& value) {
     }
 }
 
-Value& Var::dot(std::string const& s) {
+Value& Var::dot(String const& s) {
     if  (lvalue()) {
         return _lvalue()->dot(s);
     } else if  (rvalue()) {
@@ -884,4 +1194,31 @@ LuaValue& Var::value() {
     }
 }
 
+LuaValue const& Var::value() const {
+    if  (lvalue()) {
+        return _lvalue()->value();
+    } else if  (rvalue()) {
+        return _rvalue().value();
+    } else if (list()) {
+        return _list()[0].value();
+    } else {
+        _error();
+    }
+}
+
+Value const& Var::peek() const {
+    if  (lvalue()) {
+        return *_lvalue();
+    } else if  (rvalue()) {
+        if (Elipsis const* elipsis = std::get_if<Elipsis>(&_rvalue()._type)) {
+            return elipsis->size() != 0 ? elipsis->values().front() : Value::_nil;
+        }
+        return _rvalue();
+    } else if (list()) {
+        return _list()[0];
+    } else {
+        _error();
+    }
+}
+
 }
@@ -1,59 +1,108 @@
 #pragma once
 
 #include <any>
+#include <memory>
+#include <span>
 #include <string>
 #include <typeindex>
 #include <typeinfo>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 #include "LuaParser.h"
 
 #include "exceptions.h"
+#include "field_map.h"
+#include "interned_string.h"
+#include "memory.h"
 #include "meta_types.h"
+#include "shape.h"
+#include "slab_allocator.h"
+#include "small_vector.h"
 
 class FunctionAbstractionBuilderAbstraction;
 
 class Interpreter;
 
+
 namespace Types {
     struct Value;
+    class Var;
     struct Function;
     struct Userdata;
     class Table;
 
+    // Arguments and results of a call. Most calls pass a few arguments and
+    // return at most one value, which fit inline.
+    typedef SmallVector<Var, 4> VarList;
+    typedef SmallVector<Value, 4> ValueList;
+
     struct Nil {
         bool operator==(const Nil&) const;
         bool operator!=(const Nil&) const;
         bool operator<(const Nil&) const;
     };
 
+    /* Extra arguments of a vararg function. The values are immutable and
+     * shared between all the copies of an Elipsis, which are windows into
+     * the same storage: passing ... to a function, or selecting its tail
+     * with select(n, ...), never copies them.
+     */
     struct Elipsis {
     public:
-        Elipsis(std::vector<Types::Value> const& values);
-        Elipsis(Elipsis const& other);
+        Elipsis();
+        Elipsis(std::span<Types::Value const> values);
+        Elipsis(std::vector<Types::Value>&& values);
+        // The values of other after the first offset ones.
+        Elipsis(Elipsis const& other, size_t offset);
+        Elipsis(Elipsis const& other) = default;
 
-        Elipsis& operator=(Elipsis const& other);
+        Elipsis& operator=(Elipsis const& other) = default;
 
         bool operator==(const Elipsis&) const;
         bool operator!=(const Elipsis&) const;
         bool operator<(const Elipsis&) const;
 
-        std::vector<Types::Value> const& values() const { return _values; }
+        std::span<Types::Value const> values() const;
+        size_t size() const { return _size; }
 
     private:
-        std::vector<Types::Value> _values;
+        std::shared_ptr<std::vector<Types::Value> const> _values;
+        size_t _offset = 0;
+        size_t _size = 0;
     };
 
-    typedef std::variant<bool, int, double, std::string, Nil, Elipsis, Function*, Userdata*, Table*> LuaValue;
+    typedef std::variant<bool, int, double, String, Nil, Elipsis, Function*, Userdata*, Table*> LuaValue;
+
+    // Functions implemented by the interpreter itself (standard library).
+    // They receive their arguments as they were pushed by the caller, and
+    // return their results the same way Lua functions do.
+    typedef VarList (*NativeFunction)(Interpreter& interpreter, std::span<Value const> arguments);
+
+    // Native functions called with a trailing ... (f(a, ...)) that take it
+    // as is, instead of its values appended to the arguments.
+    typedef VarList (*NativeVarargFunction)(Interpreter& interpreter, std::span<Value const> arguments, Elipsis const& rest);
 
     class Function {
     public:
         Function(std::vector<std::string>&& formal_parameters, LuaParser::BlockContext* body);
         Function(FunctionAbstractionBuilderAbstraction* builder);
+        Function(NativeFunction function);
+        // Native function that receives state as its first argument, before
+        // the arguments of the call.
+        Function(NativeFunction function, Value const& state);
+        // Native function that calls vararg when called with a trailing ...
+        Function(NativeFunction function, NativeVarargFunction vararg);
 
         ~Function();
 
+        // Functions are created by every evaluation of a function
+        // definition, and tables by every constructor: both are recycled
+        // through slabs, like heap allocated Values.
+        static void* operator new(std::size_t size);
+        static void operator delete(void* ptr, std::size_t size);
+
         bool operator==(const Function& other) const;
         bool operator!=(const Function& other) const;
 
@@ -75,8 +124,26 @@ namespace Types {
             return c()._builder;
         }
 
+        NativeFunction native() const {
+            return std::get<NativeLuaFunction>(_function)._function;
+        }
+
+        // Null if the native function expands a trailing ... instead.
+        NativeVarargFunction native_vararg() const {
+            return std::get<NativeLuaFunction>(_function)._vararg;
+        }
+
+        // Null if the native function has no state.
+        Value const* native_state() const {
+            return std::get<NativeLuaFunction>(_function)._state;
+        }
+
         bool is_pure() const { return std::holds_alternative<PureLuaFunction>(_function); }
         bool is_c() const { return std::holds_alternative<CLuaFunction>(_function); }
+        bool is_native() const { return std::holds_alternative<NativeLuaFunction>(_function); }
+
+        // Account charged for the function, credited when it is released.
+        Memory::AccountId account() const { return _account; }
 
     private:
         struct PureLuaFunction {
@@ -91,7 +158,13 @@ namespace Types {
             FunctionAbstractionBuilderAbstraction* _builder;
         };
 
-        typedef std::variant<PureLuaFunction, CLuaFunction> LuaFunction;
+        struct NativeLuaFunction {
+            NativeFunction _function;
+            Value* _state = nullptr;
+            NativeVarargFunction _vararg = nullptr;
+        };
+
+        typedef std::variant<PureLuaFunction, CLuaFunction, NativeLuaFunction> LuaFunction;
 
         PureLuaFunction& pure();
         CLuaFunction& c();
@@ -100,6 +173,7 @@ namespace Types {
         CLuaFunction const& c() const;
 
         LuaFunction _function;
+        Memory::AccountId _account;
     };
 
     struct Userdata {
@@ -107,20 +181,92 @@ namespace Types {
         bool operator!=(const Userdata& other) const;
     };
 
+    /* Integer keys from 1 to array_size() are stored in the array part, a
+     * contiguous array of pointers to the values, and the other ones in
+     * _int_fields. Assigning the key right after the array part extends it,
+     * and moves the keys that follow from _int_fields. The values are never
+     * moved, so pointers to them (lvalues) stay valid while the array is
+     * reallocated or shifted; the array part can contain nil.
+     *
+     * String keys set with the dot syntax are described by the Shape of the
+     * table, and their values stored in _fields, in the same way. The other
+     * string keys (t[k] = v), and the ones added once the shape has
+     * MaxShapeSize keys, are stored in _string_fields.
+     */
     class Table {
     public:
         Table(const std::list<std::pair<Value, Value> > &values);
+        // Empty table, with room for the given number of keys.
+        Table(std::size_t array, std::size_t hash);
+        Table(Table const&) = delete;
+        ~Table();
+
+        Table& operator=(Table const&) = delete;
+
+        static void* operator new(std::size_t size);
+        static void operator delete(void* ptr, std::size_t size);
 
         bool operator==(const Table& other) const;
         bool operator!=(const Table& other) const;
 
         int border() const;
         Value& subscript(Value const&, bool set_nil = false);
-        Value& dot(std::string const&, bool set_nil = false);
-        void add_field(std::string const& name, Value const& value);
+        Value& dot(String const&, bool set_nil = false);
+
+        Shape const* shape() const { return _shape; }
+
+        // Account charged for the table, credited when it is released.
+        Memory::AccountId account() const { return _account; }
+
+        void add_field(String const& name, Value const& value);
         void add_field(Value const& source, Value const& dst);
 
+        std::size_t array_size() const { return _array.size(); }
+
+        /* Make room for the keys 1 to array in the array part, and for hash
+         * string keys, so that adding them does not reallocate. The keys
+         * already present count.
+         */
+        void reserve(std::size_t array, std::size_t hash);
+
+        // Value of the integer key i, or Value::_nil.
+        Value const& get(int i) const;
+        void set(int i, Value const& value);
+
+        /* Shift the values of the keys position to last one key up, and set
+         * position to value. Requires 1 <= position <= last + 1 and last to
+         * be a border.
+         */
+        void insert(int position, int last, Value const& value);
+
+        /* Remove the value of the key position, shift the values of the keys
+         * position + 1 to last one key down and set last to nil. Requires
+         * 1 <= position <= last and last to be a border.
+         */
+        Value remove(int position, int last);
+
+        // Metatable of the table, or Value::_nil.
+        Value const& metatable() const;
+
+        /* Set the metatable, nil to remove it. Only its __mode field is used,
+         * when it is set: a mode with "k" makes the keys of the table weak,
+         * one with "v" its values (see Collector).
+         */
+        void set_metatable(Value const& metatable);
+
+        bool weak_keys() const { return _weak_keys; }
+        bool weak_values() const { return _weak_values; }
+
     private:
+        // Number of keys after which the shape stops growing.
+        static constexpr std::size_t MaxShapeSize = 64;
+
+        Value& append();
+        Value& int_field(int i, bool set_nil);
+        // record: add the key to the shape if it is new.
+        Value& string_field(String const& key, bool set_nil, bool record);
+        static void assign(Value& slot, Value const& value);
+
         struct FieldSetter {
         public:
             FieldSetter(Table& t, Value const& value);
@@ -130,7 +276,7 @@ namespace Types {
             void operator()(int i);
             void operator()(double d);
             void operator()(bool b);
-            void operator()(std::string const& s);
+            void operator()(String const& s);
             void operator()(Function* f);
             void operator()(Table* t);
             void operator()(Userdata* u);
@@ -150,7 +296,7 @@ namespace Types {
             Value& operator()(int i);
             Value& operator()(double d);
             Value& operator()(bool b);
-            Value& operator()(std::string const& s);
+            Value& operator()(String const& s);
             Value& operator()(Function* f);
             Value& operator()(Table* t);
             Value& operator()(Userdata* u);
@@ -164,15 +310,40 @@ namespace Types {
         friend class Value;
         friend class FieldSetter;
         friend class FieldGetter;
+        friend class Collector;
+        friend class HeapSnapshot;
+
+        std::vector<Value*> _array;
+        std::map<int, Value*> _int_fields;
 
-        std::map<int, Value> _int_fields;
+        // Last border found, see border().
+        mutable std::size_t _border = 0;
         std::map<double, Value> _double_fields;
         std::vector<Value> _bool_fields;
-        std::map<std::string, Value> _string_fields;
+        Shape* _shape;
+        std::vector<Value*> _fields;
+        FieldMap _string_fields;
         std::map<Function*, Value> _function_fields;
         std::map<Table*, Value> _table_fields;
         std::map<Userdata*, Value> _userdata_fields;
 
+        Memory::AccountId _account;
+
+        // Null if the table has no metatable.
+        Value* _metatable = nullptr;
+        bool _weak_keys = false;
+        bool _weak_values = false;
+
+        // State of the table in the Collector: its generation, the links of
+        // the list of the generation, and the data of the collection in
+        // progress.
+        Table* _gc_previous = nullptr;
+        Table* _gc_next = nullptr;
+        std::ptrdiff_t _gc_references = 0;
+        std::uint8_t _generation = 0;
+        bool _gc_reachable = false;
+        bool _remembered = false;
+
         // std::map<Value*, Value*> _fields;
     };
 
@@ -204,7 +375,7 @@ namespace Types {
     struct IsReference<bool> : public std::false_type {};
 
     template<>
-    struct IsReference<std::string> : public std::false_type {};
+    struct IsReference<String> : public std::false_type {};
 
     template<typename T>
     constexpr bool IsReferenceV = IsReference<std::decay_t<T>>::value;
@@ -224,6 +395,12 @@ namespace Types {
         void add_reference(LuaValue const& l);
         void remove_reference(LuaValue& l);
 
+        // Number of references to l, 0 if it is not tracked.
+        unsigned int references(LuaValue const& l) const;
+
+        // Stop tracking l, without deleting it.
+        void forget(LuaValue const& l);
+
     private:
         GC() { }
 
@@ -234,17 +411,34 @@ namespace Types {
             template<typename T>
             void operator()(T value) { delete value; }
 
+            void operator()(Function* function);
+
             void operator()(bool) { }
             void operator()(Nil) { }
             void operator()(Elipsis) { }
             void operator()(int) { }
             void operator()(double) { }
-            void operator()(std::string const&) { }
+            void operator()(String const&) { }
         };
     };
 
     #define sGC Types::GC::instance()
 
+    // Slabs of the Values, Tables and Functions allocated by all the
+    // interpreters.
+    struct AllocationStats {
+        SlabStats _values;
+        SlabStats _tables;
+        SlabStats _functions;
+    };
+
+    // Once the tables handed to the Sweeper are deleted.
+    AllocationStats allocation_stats();
+
+    // Return the chunks of the slabs that hold no object to the system, once
+    // the tables handed to the Sweeper are deleted.
+    void release_unused_memory();
+
     class Value {
     public:
         Value();
@@ -256,14 +450,24 @@ namespace Types {
 
         constexpr bool is_refcounted() const;
 
+        // Heap allocated Values (locals, parameters, globals, closed
+        // variables) are created and released at every call. They are
+        // recycled through a slab of fixed size slots.
+        static void* operator new(std::size_t size);
+        static void operator delete(void* ptr, std::size_t size);
+
         static void init();
 
         friend Table::Table(const std::list<std::pair<Value, Value>>&);
         friend Table::FieldGetter;
         friend void Table::add_field(const Value&, const Value&);
         friend Value& Table::subscript(const Value &, bool);
-        friend Value& Table::dot(const std::string &, bool);
+        friend Value& Table::string_field(String const&, bool, bool);
+        friend Value const& Table::get(int) const;
+        friend Value const& Table::metatable() const;
+        friend Value& Table::int_field(int, bool);
         friend Interpreter;
+        friend class Var;
 
         bool operator==(const Value& other) const;
         bool operator!=(const Value& other) const;
@@ -307,7 +511,8 @@ namespace Types {
         static Value make_true();
         static Value make_false();
         static Value make_table(std::list<std::pair<Value, Value>> const& values);
-        static Value make_string(std::string&& string);
+        static Value make_table(std::size_t array, std::size_t hash);
+        static Value make_string(String const& string);
         static Value make_int(int i);
         static Value make_double(double d);
 
@@ -322,7 +527,7 @@ namespace Types {
         std::string value_as_string() const;
 
         Value& subscript(Value const& value);
-        Value& dot(std::string const& name);
+        Value& dot(String const& name);
 
         LuaValue& value();
         LuaValue const& value() const;
@@ -361,6 +566,8 @@ namespace Types {
             }
         }
 
+        // The value, or the first one of a list. Like lists, ... and the
+        // tails returned by select stand for their first value.
         Value get() const;
 
         constexpr Value* _lvalue() const {
@@ -452,9 +659,13 @@ namespace Types {
         std::string value_as_string() const;
 
         Value& subscript(Value const& value);
-        Value& dot(std::string const& s);
+        Value& dot(String const& s);
 
         LuaValue& value();
+        LuaValue const& value() const;
+
+        // Same as get(), without the copy.
+        Value const& peek() const;
 
     private:
         VarElements _value;